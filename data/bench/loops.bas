@@ -0,0 +1,17 @@
+10 REM LOOP AND ARRAY BENCHMARK
+20 DIM A(500),B(500),C(20,20)
+30 FOR J=1 TO 20
+40 FOR I=0 TO 500:A(I)=I*J:B(I)=I AND 255:NEXT I
+50 S=0:FOR I=0 TO 500:S=S+A(I)-B(I):NEXT I
+60 FOR X=0 TO 20
+70 FOR Y=0 TO 20:C(X,Y)=C(X,Y)+X*Y:NEXT Y
+80 NEXT X
+90 K=0
+100 K=K+1:IF K<100 THEN 100
+110 NEXT J
+120 N=0
+130 GOSUB 200:N=N+1:IF N<500 THEN 130
+140 PRINT S;C(20,20);T
+150 GOTO 300
+200 T=T+1:RETURN
+300 REM DONE
@@ -0,0 +1,19 @@
+10 REM MANDELBROT SET PLOT (128X128 CUT DOWN MANDELBROT_HIRES)
+20 X1=127: REM COLS
+30 Y1=127: REM ROWS
+40 C=30: REM DEPTH
+50 I1=-1.0:I2=1.0:R1=-2.0:R2=1.0: REM COORS
+80 M=4:S1=(R2-R1)/X1:S2=(I2-I1)/Y1
+90 PRINT CHR$(147)
+100 FOR Y=0 TO Y1
+110 I3=I1+S2*Y
+120 FOR X=0 TO X1
+130 R3=R1+S1*X:Z1=R3:Z2=I3
+140 FOR N=0 TO C
+150 A=Z1*Z1:B=Z2*Z2
+160 IF A+B>M THEN PLOT X,Y,N*8:GOTO 200
+170 Z2=2*Z1*Z2+I3:Z1=A-B+R3
+180 NEXT N
+200 NEXT X
+210 NEXT Y
+220 END
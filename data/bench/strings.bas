@@ -0,0 +1,13 @@
+10 REM STRING BENCHMARK
+20 DIM D$(15)
+30 B$="THE QUICK BROWN FOX JUMPS OVER THE LAZY DOG"
+40 FOR J=1 TO 200
+50 A$=""
+60 FOR I=1 TO LEN(B$):A$=MID$(B$,I,1)+A$:NEXT I
+70 C$=LEFT$(A$,10)+RIGHT$(A$,10)+STR$(J)
+80 N=0:FOR I=1 TO LEN(C$):N=N+ASC(MID$(C$,I,1)):NEXT I
+90 D$(J AND 15)=C$+CHR$(65+(N AND 15))
+100 IF D$(J AND 15)<>C$ THEN M=M+1
+110 PRINT D$(J AND 15);" ";VAL(STR$(N))
+120 NEXT J
+130 PRINT A$:PRINT M
@@ -0,0 +1,4 @@
+10 REM PLOT OUTSIDE 320X200 SCREEN (FRAMEBUFFER GROWS TO 512X512)
+20 PLOT 0,0,255:PLOT 511,0,255:PLOT 0,511,255:PLOT 511,511,255
+30 FOR I=0 TO 511 STEP 4:PLOT I,I,128:PLOT 511-I,I,64:NEXT I
+40 PRINT "DONE"
@@ -2,6 +2,9 @@
 #define CPetBasic_H
 
 #include <CExprTypes.h>
+#include <CPetBasicQueue.h>
+#include <CPetBasicMetrics.h>
+#include <CPetBasicClock.h>
 
 #include <string>
 #include <vector>
@@ -9,10 +12,17 @@
 #include <set>
 #include <iostream>
 #include <memory>
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <random>
 #include <cassert>
 
 class CPetBasicExpr;
 class CPetBasicTerm;
+class CPetBasicInputScript;
+class CPetBasicTrace;
 
 class CExprTokenStack;
 
@@ -123,31 +133,53 @@ class CAsciiChar {
   uchar c_ { 0 };
 };
 
+// packed 4 byte screen cell : bits 0-20 ascii char or utf-8 code point,
+// bit 30 set if code point, bit 31 set if reversed
 class CPetDrawChar {
  public:
-  CPetDrawChar() { }
+  constexpr CPetDrawChar() { }
 
-  explicit CPetDrawChar(uchar c, ulong utf=0, bool reverse=false) :
-   c_(c), utf_(utf), reverse_(reverse) {
+  constexpr explicit CPetDrawChar(uchar c, ulong utf=0, bool reverse=false) {
+    if (utf)
+      setUtf(utf);
+    else
+      setC(c);
+
+    setReverse(reverse);
   }
 
-  bool isSet() const { return c_ != 0 || utf_ != 0; }
+  constexpr bool isSet() const { return (value_ & CODE_MASK) != 0; }
 
-  uchar c() const { return c_; }
-  void setC(uchar c) { c_ = c; }
+  constexpr uchar c() const { return (value_ & UTF_BIT ? 0 : uchar(value_ & CODE_MASK)); }
+  constexpr void setC(uchar c) { value_ = (value_ & REVERSE_BIT) | c; }
 
-  ulong utf() const { return utf_; }
-  void setUtf(ulong utf) { utf_ = utf; }
+  constexpr ulong utf() const { return (value_ & UTF_BIT ? ulong(value_ & CODE_MASK) : 0); }
+  constexpr void setUtf(ulong utf) { value_ = (value_ & REVERSE_BIT) | (utf ? UTF_BIT | (uint(utf) & CODE_MASK) : 0); }
 
-  bool isReverse() const { return reverse_; }
-  void setReverse(bool b) { reverse_ = b; }
+  constexpr bool isReverse() const { return (value_ & REVERSE_BIT); }
+  constexpr void setReverse(bool b) { if (b) value_ |= REVERSE_BIT; else value_ &= ~REVERSE_BIT; }
+
+  // raw packed value
+  constexpr uint value() const { return value_; }
+
+  friend bool operator==(const CPetDrawChar &lhs, const CPetDrawChar &rhs) {
+    return lhs.value_ == rhs.value_;
+  }
+
+  friend bool operator!=(const CPetDrawChar &lhs, const CPetDrawChar &rhs) {
+    return lhs.value_ != rhs.value_;
+  }
 
  private:
-  uchar c_       { 0 };     // ascii char to draw
-  ulong utf_     { 0 };     // utf-8 char to draw
-  bool  reverse_ { false }; // is reversed
+  static constexpr uint CODE_MASK   = 0x001fffff;
+  static constexpr uint UTF_BIT     = 0x40000000;
+  static constexpr uint REVERSE_BIT = 0x80000000;
+
+  uint value_ { 0 };
 };
 
+static_assert(sizeof(CPetDrawChar) == 4, "CPetDrawChar must be packed into 4 bytes");
+
 //---
 
 class CPetBasic {
@@ -272,6 +304,7 @@ class CPetBasic {
     uint        lineN   { 0 };
     Tokens      tokens;
     Statements  statements;
+    mutable int pollLoop { -1 }; // cached isPollLoopLine (-1 unknown)
   };
 
   using Lines = std::map<uint, LineData>;
@@ -320,19 +353,40 @@ class CPetBasic {
 
   bool run();
 
+  // reset run position to start of program (for runFor)
+  void startRun();
+
   bool step();
 
   bool contRun();
   bool contRunTo(uint lineNum);
 
+  // time sliced run : run at most maxStatements statements (0 for no limit) and for
+  // at most maxUSecs microseconds (0 for no limit, checked between lines), resuming
+  // from where the previous slice stopped. Input and delays suspend the run
+  // (see setResumable) and return WAITING.
+  enum class RunStatus {
+    RUNNING, // slice used up, call again to continue
+    WAITING, // waiting for input or delay (see waitType, canResume)
+    STOPPED, // program ended or stopped (STOP, END, break point)
+    ERROR    // program error
+  };
+
+  RunStatus runFor(long maxStatements, long maxUSecs=0);
+
   void setRaw(bool b);
 
+  // use headless terminal (no I/O, see CPetBasicNullTerm)
+  void setHeadless();
+
   void loop();
 
   bool inputLine(const std::string &lineBuffer);
 
   int lineInd() const { return lineInd_; }
 
+  uint statementNum() const { return statementNum_; }
+
   int currentLineNum() const;
 
   int lineIndNum(int lineInd) const;
@@ -350,6 +404,189 @@ class CPetBasic {
 
   //---
 
+  // keyboard buffer (like PET keyboard buffer) : filled by terminal backend (can be
+  // from another thread), read by GET/INPUT without blocking
+  void pushKey(uchar c); // dropped if full
+  void pushKeys(const std::string &str) { for (const auto &c : str) pushKey(uchar(c)); }
+
+  bool popKey(uchar &c) { return keyBuffer_.pop(c); }
+
+  bool hasKey() const { return ! keyBuffer_.isEmpty(); }
+
+  void clearKeys() { keyBuffer_.clear(); }
+
+  // wait (up to usecs) for key to be pushed or run to be stopped
+  bool waitKey(long usecs);
+
+  // wait (up to usecs) for run to be stopped (interruptible delay)
+  bool waitStopped(long usecs);
+
+  // is line an idle keyboard poll loop (GET X$:IF X$="" THEN <same line>)
+  bool isPollLoopLine(const LineData &lineData) const;
+
+  // max time to park in idle poll loop before re-checking (usecs)
+  long idleWait() const { return idleWait_; }
+  void setIdleWait(long t) { idleWait_ = t; }
+
+  // scripted input (see CPetBasicInputScript) : script keys are typed into the
+  // keyboard buffer when GET/INPUT find it empty
+  bool loadInputScript(const std::string &fileName);
+  void clearInputScript();
+
+  bool hasInputScript() const { return !! inputScript_; }
+
+  //---
+
+  // RND generator (per interpreter) : seeded from random device unless fixed seed set
+  void setRandomSeed(ulong seed);
+
+  double randomValue();
+
+  //---
+
+  // jiffy clock (see CPetBasicClock) for TI, TI$ and ELAPSED : real time unless virtual
+  // clock set (time advanced by statements run and DELAYs so TI reads are repeatable)
+  bool isVirtualClock() const { return clock_.isVirtual(); }
+  void setVirtualClock(bool b, long statementUSecs=CPetBasicClock::defaultStatementUSecs);
+
+  long jiffies();
+
+  std::string timeString();
+  bool setTimeString(const std::string &str);
+
+  // TI value (reused while jiffy count is unchanged)
+  CExprValuePtr jiffiesValue();
+
+  //---
+
+  // execution trace (see CPetBasicTrace) : record statements, branches, input and RND
+  // results of runs to a memory mapped ring file, or replay a recorded run. Replay
+  // takes input and RND results from the trace and stops the run with an error if
+  // execution diverges from it.
+  static const size_t defaultTraceCapacity = 1 << 20; // records
+
+  bool startTraceRecord(const std::string &fileName, size_t capacity=defaultTraceCapacity);
+  bool startTraceReplay(const std::string &fileName);
+  void stopTrace();
+
+  bool isTraceRecord() const { return traceRecord_; }
+  bool isTraceReplay() const { return traceReplay_; }
+
+  // flattened statement index (as used by trace) to line number and statement number
+  uint numStatements() const { return numStatements_; }
+  bool statementLine(uint ind, uint &lineNum, uint &statementNum) const;
+
+  //---
+
+  // resumable execution : when enabled INPUT, GET (in an idle poll loop) and DELAY
+  // suspend the run instead of blocking in the terminal. contRun returns with
+  // isWaiting() set and the host calls contRun again to resume the suspended
+  // statement once keys have been pushed (INPUT echoes them and completes on
+  // RETURN) or the delay has passed.
+  enum class WaitType {
+    NONE,
+    INPUT,
+    GET,
+    DELAY
+  };
+
+  bool isResumable() const { return resumable_; }
+  void setResumable(bool b) { resumable_ = b; }
+
+  bool isWaiting() const { return waitData_.type != WaitType::NONE; }
+  WaitType waitType() const { return waitData_.type; }
+
+  // can waiting run make progress (key available or delay passed)
+  bool canResume() const;
+
+  // usecs until delay ends (0 if not waiting for delay)
+  long waitRemaining() const;
+
+  // end waiting delay now (headless runs which don't need real time)
+  void skipDelay();
+
+  //---
+
+  // break points stop the run before a statement is executed. They are stored as a
+  // bit per statement of the flattened program so, when any break or watch point is
+  // set, each statement costs one bit test (and nothing extra when none are set).
+  // An optional condition (BASIC expression) is evaluated when the bit is set and
+  // the break only happens if it is non-zero.
+  bool addBreakpoint(uint lineNum, uint statementNum=0, const std::string &condition="");
+  void removeBreakpoint(uint lineNum, uint statementNum=0);
+  bool hasBreakpoint(uint lineNum, uint statementNum=0) const;
+  void clearBreakpoints();
+
+  // watch points stop the run after the statement which assigns a watched variable
+  // (scalar or array) or writes a watched memory address (POKE)
+  void addVariableWatch(const std::string &name);
+  void removeVariableWatch(const std::string &name);
+  void addMemoryWatch(uint addr);
+  void removeMemoryWatch(uint addr);
+  void clearWatchpoints();
+
+  // description of last break or watch point hit
+  const std::string &breakReason() const { return breakReason_; }
+
+  //---
+
+  // profiler : execution count and time of each program statement (indexed by
+  // flattened statement so recording is two clock reads and an add per statement)
+  struct ProfileData {
+    long count { 0 };
+    long nsecs { 0 };
+  };
+
+  bool isProfile() const { return profile_; }
+  void setProfile(bool b) { profile_ = b; }
+
+  void clearProfile();
+
+  // profile data of line (sum of its statements)
+  bool getLineProfile(uint lineNum, ProfileData &data) const;
+
+  // print hottest lines (by time) with count, time and percent of total
+  void printProfile(std::ostream &os, uint maxLines=20) const;
+
+  //---
+
+  // run time metrics (statements, expressions, allocations, ...)
+  const CPetBasicMetrics &metrics() const { updateMetrics(); return metrics_; }
+  CPetBasicMetrics &metrics() { return metrics_; }
+
+  void resetMetrics();
+
+  // update derived metrics (value allocations) before reading non-const metrics
+  void updateMetrics() const;
+
+  //---
+
+  // sampling profiler : a profiling timer (SIGPROF) samples the current statement and
+  // interpreter activity into a lock free queue (no instrumentation of each statement,
+  // the run only publishes its position). Only one interpreter can sample at a time and
+  // sampling must be started and stopped on the thread running the interpreter (the
+  // timer measures and signals only that thread).
+  enum class SampleCategory {
+    INTERP,   // statement execution
+    EXPR,     // expression evaluation
+    VARIABLE, // variable lookup
+    TERMINAL, // terminal output/update
+    NUM
+  };
+
+  bool startSampling(long usecs=1000);
+  void stopSampling();
+
+  bool isSampling() const { return sampling_; }
+
+  void clearSamples();
+
+  // print flat (by line, with activity breakdown) and inverted (by activity, with
+  // hottest lines) sample profiles
+  void printSamples(std::ostream &os, uint maxLines=20) const;
+
+  //---
+
   virtual void resize(uint nr, uint nc);
 
   uint numRows() const { return nr_; }
@@ -363,6 +600,15 @@ class CPetBasic {
 
   //---
 
+  // notification batching : run line, line number and variable changes are recorded
+  // and published (using the notify methods) at most maxNotifyRate times a second
+  // or at a sync point (flushNotify)
+  double maxNotifyRate() const { return maxNotifyRate_; }
+  void setMaxNotifyRate(double r) { maxNotifyRate_ = r; }
+
+  void checkNotify();
+  void flushNotify();
+
   virtual void notifyRunLine(uint /*n*/) const { }
 
   //---
@@ -411,7 +657,36 @@ class CPetBasic {
   void getVariableNames(std::vector<std::string> &names,
                         std::vector<std::string> &arrayNames) const;
 
-  virtual void notifyVariablesChanged() { }
+  // array dimension sizes (upper bound + 1) and value at flat index (last index fastest)
+  bool getArrayDims(const std::string &name, Inds &dims) const;
+  CExprValuePtr getArrayValue(const std::string &name, uint i) const;
+
+  // names of variables changed since last notify. reset is set when variables are
+  // cleared or too many have changed to track individually
+  struct VariableChanges {
+    bool                  reset { false };
+    std::set<std::string> names;
+    std::set<std::string> arrayNames;
+
+    bool isSet() const { return reset || ! names.empty() || ! arrayNames.empty(); }
+
+    void add(const VariableChanges &changes) {
+      reset = reset || changes.reset;
+
+      if (reset) {
+        names     .clear();
+        arrayNames.clear();
+        return;
+      }
+
+      names     .insert(changes.names     .begin(), changes.names     .end());
+      arrayNames.insert(changes.arrayNames.begin(), changes.arrayNames.end());
+    }
+
+    void clear() { *this = VariableChanges(); }
+  };
+
+  virtual void notifyVariablesChanged(const VariableChanges & /*changes*/) { }
 
   //---
 
@@ -850,6 +1125,23 @@ class CPetBasic {
 
   bool runTokens(const LineRef &lineRef, const Tokens &tokens, bool &nextLine);
 
+  RunStatus runLines(long maxStatements, long maxUSecs);
+
+  void suspend(WaitType type);
+  bool resumeWait();
+  void clearWait();
+
+  // type next input script keys if keyboard buffer empty (idle when nothing else can run)
+  bool feedInputScript(bool idle);
+
+  // trace current statement, IF result, GET result, INPUT line (record or check/replay)
+  bool traceStatement();
+  bool traceBranch(bool b);
+  bool traceGet(uchar &c);
+  bool traceInput(std::string &line);
+
+  bool traceDiverged(const std::string &msg);
+
   void addData(const std::string &dataStr) const;
 
   //---
@@ -961,6 +1253,39 @@ class CPetBasic {
 
   //---
 
+  void updateStatementInds();
+
+  struct BreakData {
+    uint        lineNum      { 0 };
+    uint        statementNum { 0 };
+    std::string condition;
+    Tokens      tokens;   // condition tokens (owned)
+    ExprData    exprData; // compiled condition
+  };
+
+  void updateBreakBits();
+  void updateBreakEnabled();
+
+  int flatStatementInd() const;
+
+  bool checkBreak();
+
+  void checkVariableWatch(const std::string &uname) const;
+
+  void deleteBreakCondition(BreakData &breakData);
+
+  //---
+
+  void queueRunLine(uint n) { changes_.runLineNum = n; changes_.runLine = true; }
+
+  void queueLineNumChanged() { changes_.lineNumChanged = true; }
+
+  void queueVariablesChanged() const;
+  void queueVariableChanged(const std::string &uname) const;
+  void queueArrayVariableChanged(const std::string &uname) const;
+
+  //---
+
   bool evalExprData(const ExprData &exprData, CExprValuePtr &val) const;
 
  public:
@@ -1081,6 +1406,102 @@ class CPetBasic {
 
   //---
 
+  // break and watch points
+  using BreakKey      = std::pair<uint, uint>;
+  using Breakpoints   = std::map<BreakKey, BreakData>;
+  using StatementInds = std::vector<uint>;
+  using BreakBits     = std::vector<bool>;
+  using WatchNames    = std::set<std::string>;
+  using MemoryWatches = std::set<uint>;
+
+  Breakpoints   breakpoints_;
+  StatementInds statementInds_;         // flattened index of first statement per line
+  uint          numStatements_ { 0 };   // number of flattened statements
+  BreakBits     breakBits_;             // break point bit per flattened statement
+  WatchNames    variableWatches_;
+  MemoryWatches memoryWatches_;
+  bool          breakEnabled_ { false }; // any break or watch points
+  bool          watchHit_     { false }; // watch point hit by current statement
+  int           breakSkipInd_ { -1 };    // break point statement to skip on resume
+  std::string   breakReason_;
+
+  //---
+
+  // metrics (value allocations counted since reset)
+  mutable CPetBasicMetrics metrics_;
+  long                     valueAllocBase_ { 0 };
+
+  //---
+
+  // sampling profiler
+  struct Sample {
+    int            lineInd  { -1 };
+    SampleCategory category { SampleCategory::INTERP };
+  };
+
+  using SampleQueue  = CPetBasicQueue<Sample, 4096>;
+  using SampleCounts = std::array<long, size_t(SampleCategory::NUM)>;
+  using LineSamples  = std::map<int, SampleCounts>;
+
+  // set category for scope (restores previous on exit)
+  class SampleScope {
+   public:
+    SampleScope(const CPetBasic *basic, SampleCategory category) :
+     basic_(basic->sampling_ ? basic : nullptr) {
+      if (basic_)
+        category_ = basic_->sampleCategory_.exchange(category, std::memory_order_relaxed);
+    }
+
+   ~SampleScope() {
+      if (basic_)
+        basic_->sampleCategory_.store(category_, std::memory_order_relaxed);
+    }
+
+   private:
+    const CPetBasic* basic_    { nullptr };
+    SampleCategory   category_ { SampleCategory::INTERP };
+  };
+
+  static void sampleSignal(int sig);
+
+  void drainSamples() const;
+
+  bool                                sampling_ { false };
+  mutable std::atomic<int>            sampleLineInd_  { -1 };
+  mutable std::atomic<SampleCategory> sampleCategory_ { SampleCategory::INTERP };
+  mutable SampleQueue                 sampleQueue_;
+  mutable LineSamples                 lineSamples_; // sample counts by line number
+  std::atomic<long>                   samplesDropped_ { 0 };
+
+  //---
+
+  // profiler
+  using ProfileDatas = std::vector<ProfileData>;
+
+  bool         profile_ { false };
+  ProfileDatas profileData_; // per flattened statement
+
+  //---
+
+  // pending (unpublished) notifications
+  struct Changes {
+    bool            runLine        { false };
+    uint            runLineNum     { 0 };
+    bool            lineNumChanged { false };
+    VariableChanges variables;
+
+    bool isSet() const { return runLine || lineNumChanged || variables.isSet(); }
+  };
+
+  // max variable names tracked per notify before falling back to reset
+  static constexpr uint maxVariableChanges = 64;
+
+  mutable Changes changes_;
+  double          maxNotifyRate_  { 20.0 }; // max publishes per second (0 is unlimited)
+  long            lastNotifyTime_ { 0 };    // usecs of last publish
+
+  //---
+
   CPetBasicTerm *term_ { nullptr };
 
   //---
@@ -1095,7 +1516,45 @@ class CPetBasic {
   LineStack lineStack_;
   ForDatas  forDatas_;
 
-  bool stopped_ { false };
+  std::atomic<bool> stopped_ { false }; // can be set by another thread to stop run
+
+  CPetBasicQueue<uchar, 256> keyBuffer_;
+  std::mutex                 keyMutex_;
+  std::condition_variable    keyCond_;
+  long                       idleWait_ { 100000 };
+
+  // scripted input
+  std::unique_ptr<CPetBasicInputScript> inputScript_;
+  long                                  inputScriptWait_ { -1 }; // statement of first read
+
+  std::mt19937 random_;
+
+  // jiffy clock
+  CPetBasicClock clock_;
+  CExprValuePtr  jiffiesValue_;
+  long           elapsedUSecs_ { -1 }; // clock at last ELAPSED
+
+  // execution trace
+  std::unique_ptr<CPetBasicTrace> trace_;
+  bool                            traceRecord_ { false };
+  bool                            traceReplay_ { false };
+
+  // suspended statement (resumable mode)
+  struct WaitData {
+    WaitType    type     { WaitType::NONE };
+    LineRef     lineRef;
+    Tokens      tokens;              // statement tokens run again on resume
+    bool        resuming { false };  // statement is being resumed
+    std::string input;               // INPUT chars entered so far
+    uint        varInd   { 0 };      // INPUT variable being read
+    long        endTime  { 0 };      // DELAY end time (usecs)
+  };
+
+  bool     resumable_ { false };
+  WaitData waitData_;
+
+  long statementBudget_ { -1 }; // statements left in runFor slice (-1 unlimited)
+
   bool reverse_ { false };
   bool shift_   { false };
 
@@ -1133,6 +1592,13 @@ class CPetBasic {
    public:
     ArrayData() { }
 
+    const Dims &dims() const { return dims_; }
+
+    uint numValues() const { return uint(values_.size()); }
+
+    CExprValuePtr valueAt(uint i) const {
+      return (i < values_.size() ? values_[i] : CExprValuePtr()); }
+
     void resize(uint n) {
       Dims dims;
       dims.push_back(n);
@@ -0,0 +1,58 @@
+#ifndef CPetBasicClock_H
+#define CPetBasicClock_H
+
+#include <string>
+
+// jiffy clock for TI, TI$ and ELAPSED
+//
+// The PET counts jiffies (1/60 second) from power on, TI$ is the same count as HHMMSS
+// and both wrap at 24 hours. Setting TI$ sets the count.
+//
+// The clock is either real (monotonic system clock) or virtual. Virtual time is
+// advanced by the statements run (a fixed time per statement) and by delays, so runs
+// read the same TI values each time. Virtual time is calculated from the interpreter's
+// statement count when read so it costs nothing per statement.
+class CPetBasicClock {
+ public:
+  static const long jiffiesPerSec = 60;
+  static const long jiffiesPerDay = 24*60*60*jiffiesPerSec;
+
+  static const long defaultStatementUSecs = 1000; // roughly PET BASIC speed
+
+ public:
+  CPetBasicClock();
+
+  // restart count from zero (power on)
+  void reset();
+
+  bool isVirtual() const { return virtual_; }
+  void setVirtual(bool b, long statementUSecs=defaultStatementUSecs);
+
+  long statementUSecs() const { return statementUSecs_; }
+
+  // time since reset in usecs (statements is interpreter statement count)
+  long usecs(long statements) const;
+
+  // TI : jiffies (wraps at 24 hours)
+  long jiffies(long statements) const;
+  void setJiffies(long jiffies, long statements);
+
+  // TI$ : HHMMSS
+  std::string timeString(long statements) const;
+  bool setTimeString(const std::string &str, long statements);
+
+  static std::string jiffiesToString(long jiffies);
+
+  // virtual clock : add time spent waiting (DELAY)
+  void addDelay(long usecs);
+
+ private:
+  bool         virtual_        { false };
+  long         statementUSecs_ { defaultStatementUSecs };
+  long         baseUSecs_      { 0 }; // real clock at reset
+  long         offsetJiffies_  { 0 }; // set by TI$
+  mutable long virtualUSecs_   { 0 };
+  mutable long lastStatements_ { 0 }; // statement count at last virtual update
+};
+
+#endif
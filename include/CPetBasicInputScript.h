@@ -0,0 +1,53 @@
+#ifndef CPetBasicInputScript_H
+#define CPetBasicInputScript_H
+
+#include <string>
+#include <vector>
+
+// scripted keyboard input for unattended (replay) runs
+//
+// Each script line is one input event whose keys are typed into the keyboard buffer
+// when the program next reads a key (GET/INPUT) and the buffer is empty:
+//   [+<n>] <keys>
+//  . +<n>   : only type keys once the program has been reading keys for at least n
+//             statements (for programs which clear the keyboard buffer before
+//             reading). The delay is skipped when the program is in an idle poll
+//             loop as nothing can change until a key arrives
+//  . <keys> : typed as is except for escapes \r (RETURN), \\ and \xNN (char code)
+//  . lines starting with # are comments and blank lines are ignored
+//
+// Delays are counted in statements (not time) so replays are repeatable.
+class CPetBasicInputScript {
+ public:
+  struct Event {
+    long        delay { 0 }; // statements to run before keys are typed
+    std::string keys;
+  };
+
+  using Events = std::vector<Event>;
+
+ public:
+  CPetBasicInputScript() { }
+
+  bool load(const std::string &fileName);
+
+  bool addLine(const std::string &line);
+
+  const Events &events() const { return events_; }
+
+  bool isDone() const { return pos_ >= events_.size(); }
+
+  // get keys of next event if due (statements run since program started reading)
+  bool nextKeys(long statements, bool idle, std::string &keys);
+
+  void rewind() { pos_ = 0; }
+
+  const std::string &errorMsg() const { return errorMsg_; }
+
+ private:
+  Events      events_;
+  size_t      pos_ { 0 };
+  std::string errorMsg_;
+};
+
+#endif
@@ -0,0 +1,109 @@
+#ifndef CPetBasicMetrics_H
+#define CPetBasicMetrics_H
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <sstream>
+#include <string>
+
+// interpreter metrics registry
+//  . counters are only added to by the interpreter thread (add is a relaxed load and
+//    store, not a locked read/modify/write) and can be read from any thread
+//  . values() is a snapshot for status lines and JSON export
+class CPetBasicMetrics {
+ public:
+  enum class Metric {
+    STATEMENTS,       // statements executed
+    EXPRESSIONS,      // expressions evaluated
+    VALUE_ALLOCS,     // CExprValue allocations (set from CExprValue::numCreated)
+    VARIABLE_LOOKUPS, // scalar and array variable lookups
+    TERM_UPDATES,     // terminal redraws
+    BYTES_WRITTEN,    // bytes written to terminal output
+    GET_POLLS,        // GET with no key available
+    INPUT_WAIT_USECS, // time spent waiting for INPUT/GET keys
+    NUM
+  };
+
+  static constexpr size_t numMetrics = size_t(Metric::NUM);
+
+  using Values = std::array<long, numMetrics>;
+
+ public:
+  CPetBasicMetrics() { reset(); }
+
+  CPetBasicMetrics(const CPetBasicMetrics &) = delete;
+  CPetBasicMetrics &operator=(const CPetBasicMetrics &) = delete;
+
+  static const char *name(Metric metric) {
+    static const char *names[] = {
+      "statements", "expressions", "value_allocs", "variable_lookups",
+      "term_updates", "bytes_written", "get_polls", "input_wait_usecs" };
+
+    static_assert(sizeof(names)/sizeof(names[0]) == numMetrics, "metric names");
+
+    return names[size_t(metric)];
+  }
+
+  void add(Metric metric, long n=1) {
+    auto &value = values_[size_t(metric)];
+    value.store(value.load(std::memory_order_relaxed) + n, std::memory_order_relaxed); }
+
+  void set(Metric metric, long n) {
+    values_[size_t(metric)].store(n, std::memory_order_relaxed); }
+
+  long value(Metric metric) const {
+    return values_[size_t(metric)].load(std::memory_order_relaxed); }
+
+  Values values() const {
+    Values values;
+    for (size_t i = 0; i < numMetrics; ++i)
+      values[i] = values_[i].load(std::memory_order_relaxed);
+    return values;
+  }
+
+  void reset() {
+    for (auto &value : values_)
+      value.store(0, std::memory_order_relaxed);
+  }
+
+  // {"statements": n, ...}
+  std::string toJson() const {
+    auto values = this->values();
+
+    std::stringstream ss;
+
+    ss << "{";
+
+    for (size_t i = 0; i < numMetrics; ++i) {
+      if (i > 0) ss << ", ";
+
+      ss << "\"" << name(Metric(i)) << "\": " << values[i];
+    }
+
+    ss << "}";
+
+    return ss.str();
+  }
+
+  // short single line summary for status lines
+  std::string statusString() const {
+    std::stringstream ss;
+
+    ss << "STMT: "  << value(Metric::STATEMENTS) <<
+          " EXPR: " << value(Metric::EXPRESSIONS) <<
+          " VAL: "  << value(Metric::VALUE_ALLOCS) <<
+          " VAR: "  << value(Metric::VARIABLE_LOOKUPS) <<
+          " UPD: "  << value(Metric::TERM_UPDATES) <<
+          " OUT: "  << value(Metric::BYTES_WRITTEN) <<
+          " POLL: " << value(Metric::GET_POLLS) <<
+          " WAIT: " << value(Metric::INPUT_WAIT_USECS)/1000 << "ms";
+
+    return ss.str();
+  }
+
+ private:
+  std::array<std::atomic<long>, numMetrics> values_;
+};
+
+#endif
@@ -0,0 +1,67 @@
+#ifndef CPetBasicNullTerm_H
+#define CPetBasicNullTerm_H
+
+#include <CPetBasicTerm.h>
+
+// headless terminal for batch and benchmark runs
+//  . keeps cell buffer and PLOT framebuffer in memory and does no I/O while running
+//  . input only comes from the keyboard buffer (CPetBasic::pushKey) and delays don't wait
+//  . final screen can be dumped as text and framebuffer as PPM
+//  . framebuffer starts at screen size (8x8 pixels per cell) and grows to cover PLOTs
+//    outside it (up to maxPlotSize)
+class CPetBasicNullTerm : public CPetBasicTerm {
+ public:
+  CPetBasicNullTerm(CPetBasic *basic);
+
+  virtual ~CPetBasicNullTerm();
+
+  //---
+
+  bool isTty() const override { return false; }
+
+  //---
+
+  void resize(uint nr, uint nc) override;
+
+  bool plotOutside(long x, long y, long color) override;
+
+  //---
+
+  void loop() override;
+
+  std::string readString(const std::string &prompt) const override;
+  char readChar() const override;
+
+  bool waitKey(long usecs) override;
+
+  //---
+
+  void redraw() override;
+
+  void delay(long t) override;
+
+  //---
+
+  // screen rows as text (trailing spaces removed)
+  std::string screenText() const;
+
+  bool writeScreen(const std::string &fileName) const;
+
+  // framebuffer (screen size or PLOT extent if larger) as binary (P6) PPM
+  bool writeFrameBuffer(const std::string &fileName) const;
+
+  uint frameWidth () const;
+  uint frameHeight() const;
+
+ private:
+  // framebuffer pixels per character cell
+  static constexpr uint cellPixels = 8;
+
+  // max framebuffer width/height grown to for PLOT
+  static constexpr uint maxPlotSize = 4096;
+
+  uint plotWidth_  { 0 }; // extent of PLOTs outside screen size
+  uint plotHeight_ { 0 };
+};
+
+#endif
@@ -0,0 +1,89 @@
+#ifndef CPetBasicQueue_H
+#define CPetBasicQueue_H
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <utility>
+
+// fixed size lock free queue for one producer thread and one consumer thread
+//  . push() must only be called by the producer, pop()/clear() by the consumer
+//  . push() fails (returns false) when the queue is full
+template<typename T, size_t N>
+class CPetBasicQueue {
+ public:
+  static_assert(N > 1, "queue size must be greater than one");
+
+  CPetBasicQueue() { }
+
+  CPetBasicQueue(const CPetBasicQueue &) = delete;
+  CPetBasicQueue &operator=(const CPetBasicQueue &) = delete;
+
+  size_t capacity() const { return N - 1; }
+
+  bool isEmpty() const {
+    return head_.load(std::memory_order_acquire) == tail_.load(std::memory_order_acquire); }
+
+  size_t size() const {
+    auto head = head_.load(std::memory_order_acquire);
+    auto tail = tail_.load(std::memory_order_acquire);
+    return (tail >= head ? tail - head : tail + N - head); }
+
+  bool push(const T &t) {
+    auto tail  = tail_.load(std::memory_order_relaxed);
+    auto tail1 = next(tail);
+
+    if (tail1 == head_.load(std::memory_order_acquire))
+      return false;
+
+    data_[tail] = t;
+
+    tail_.store(tail1, std::memory_order_release);
+
+    return true;
+  }
+
+  bool push(T &&t) {
+    auto tail  = tail_.load(std::memory_order_relaxed);
+    auto tail1 = next(tail);
+
+    if (tail1 == head_.load(std::memory_order_acquire))
+      return false;
+
+    data_[tail] = std::move(t);
+
+    tail_.store(tail1, std::memory_order_release);
+
+    return true;
+  }
+
+  bool pop(T &t) {
+    auto head = head_.load(std::memory_order_relaxed);
+
+    if (head == tail_.load(std::memory_order_acquire))
+      return false;
+
+    t = std::move(data_[head]);
+
+    head_.store(next(head), std::memory_order_release);
+
+    return true;
+  }
+
+  void clear() {
+    T t;
+
+    while (pop(t))
+      ;
+  }
+
+ private:
+  static size_t next(size_t i) { return (i + 1 < N ? i + 1 : 0); }
+
+ private:
+  std::array<T, N>    data_;
+  std::atomic<size_t> head_ { 0 }; // next slot to pop (written by consumer)
+  std::atomic<size_t> tail_ { 0 }; // next slot to push (written by producer)
+};
+
+#endif
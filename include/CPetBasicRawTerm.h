@@ -35,6 +35,11 @@ class CPetBasicRawTerm : public CPetBasicTerm {
   std::string readString(const std::string &prompt) const override;
   char readChar() const override;
 
+  bool waitKey(long usecs) override;
+
+  // read available stdin keys into keyboard buffer
+  void pollKeys();
+
   //---
 
   void clear() override;
@@ -53,13 +58,17 @@ class CPetBasicRawTerm : public CPetBasicTerm {
   bool drawChar(const uchar &c) override;
   bool drawChar(const CPetDrawChar &drawChar) override;
 
-  void update() override;
+  void redraw() override;
 
   void delay(long t) override;
 
  protected:
   void setRaw(bool b);
 
+  // write to stdout (counted in metrics)
+  void writeOut(const std::string &str);
+  void writeOut(char c);
+
  protected:
   bool raw_ { false };
 
@@ -3,12 +3,126 @@
 
 #include <CPetBasic.h>
 
+#include <algorithm>
+
 using uint  = unsigned int;
 using uchar = unsigned char;
 
 class CPetBasic;
 
 class CPetBasicTerm {
+ public:
+  using Chars = std::vector<CPetDrawChar>;
+
+  // bounding rectangle of cells changed since last redraw
+  struct DirtyRect {
+    int r1 { -1 };
+    int c1 { -1 };
+    int r2 { -1 };
+    int c2 { -1 };
+
+    bool isSet() const { return r1 >= 0; }
+
+    void add(int r, int c) {
+      if (! isSet()) { r1 = r2 = r; c1 = c2 = c; return; }
+      r1 = std::min(r1, r); r2 = std::max(r2, r);
+      c1 = std::min(c1, c); c2 = std::max(c2, c);
+    }
+
+    void add(const DirtyRect &rect) {
+      if (rect.isSet()) { add(rect.r1, rect.c1); add(rect.r2, rect.c2); }
+    }
+
+    void reset() { r1 = c1 = r2 = c2 = -1; }
+  };
+
+  // PLOT framebuffer (grey level per pixel, 0 is background) written through
+  // precomputed scanline pointers with range of rows changed since last redraw
+  class FrameBuffer {
+   public:
+    FrameBuffer() { }
+
+    FrameBuffer(const FrameBuffer &) = delete;
+    FrameBuffer &operator=(const FrameBuffer &) = delete;
+
+    uint width () const { return w_; }
+    uint height() const { return h_; }
+
+    void resize(uint w, uint h) {
+      w_ = w; h_ = h;
+      data_.assign(size_t(w_)*h_, 0);
+      rows_.resize(h_);
+      for (uint y = 0; y < h_; ++y) rows_[y] = &data_[size_t(y)*w_];
+      markAllDirty();
+    }
+
+    // grow to at least w x h keeping current pixels
+    void grow(uint w, uint h) {
+      w = std::max(w, w_); h = std::max(h, h_);
+      if (w == w_ && h == h_) return;
+      Data data(size_t(w)*h, 0);
+      for (uint y = 0; y < h_; ++y) std::copy(rows_[y], rows_[y] + w_, &data[size_t(y)*w]);
+      w_ = w; h_ = h; data_.swap(data);
+      rows_.resize(h_);
+      for (uint y = 0; y < h_; ++y) rows_[y] = &data_[size_t(y)*w_];
+      markAllDirty();
+    }
+
+    uchar *scanLine(uint y) { return rows_[y]; }
+    const uchar *scanLine(uint y) const { return rows_[y]; }
+
+    // set pixel (ignored if outside buffer)
+    bool setPixel(long x, long y, long c) {
+      if (x < 0 || y < 0 || x >= long(w_) || y >= long(h_)) return false;
+      rows_[y][x] = uchar(std::min(std::max(c, 0L), 255L));
+      if (y1_ < 0) { y1_ = y2_ = int(y); }
+      else { if (y < y1_) y1_ = int(y); if (y > y2_) y2_ = int(y); }
+      return true;
+    }
+
+    void clear() { std::fill(data_.begin(), data_.end(), 0); markAllDirty(); }
+
+    bool isDirty() const { return y1_ >= 0; }
+    int dirtyRow1() const { return y1_; }
+    int dirtyRow2() const { return y2_; }
+
+    void markAllDirty() { if (h_ > 0) { y1_ = 0; y2_ = int(h_) - 1; } }
+    void resetDirty() { y1_ = y2_ = -1; }
+
+   private:
+    using Data = std::vector<uchar>;
+    using Rows = std::vector<uchar *>;
+
+    uint w_  { 0 };
+    uint h_  { 0 };
+    Data data_;
+    Rows rows_;
+    int  y1_ { -1 };
+    int  y2_ { -1 };
+  };
+
+  using Pixels = std::vector<uchar>;
+
+  // copy of screen cells (in display row order) and cursor
+  struct Screen {
+    uint  nr { 0 };
+    uint  nc { 0 };
+    int   r  { 0 };
+    int   c  { 0 };
+    Chars chars;
+
+    DirtyRect dirty; // cells changed since previous snapshot
+
+    // framebuffer rows changed since previous snapshot (py1 to py2)
+    uint   pw  { 0 };
+    uint   ph  { 0 };
+    int    py1 { -1 };
+    int    py2 { -1 };
+    Pixels pixels;
+
+    const CPetDrawChar &getChar(uint r1, uint c1) const { return chars[r1*nc + c1]; }
+  };
+
  public:
   CPetBasicTerm(CPetBasic *basic);
 
@@ -42,11 +156,22 @@ class CPetBasicTerm {
   virtual CPetDrawChar getChar(uint r, uint c) const;
   virtual void setChar(uint r, uint c, const CPetDrawChar &drawChar);
 
+  // contiguous cells (numCols) of row (can be compared with memcmp)
+  const CPetDrawChar *rowChars(uint r) const { return &chars_[cellIndex(r, 0)]; }
+
   uint encodeCharPos(uint r, uint c) const {
     assert(r < nr_ && c < nc_); return r*nc_ + c; }
   void decodeCharPos(uint pos, uint &r, uint &c) const {
     assert(pos < nr_*nc_); r = pos/nc_; c = pos - r*nc_; }
 
+  // index of screen cell in chars_ (rows are stored as a ring buffer starting at topRow_)
+  uint cellIndex(uint r, uint c) const {
+    assert(r < nr_ && c < nc_);
+    auto r1 = r + topRow_; if (r1 >= nr_) r1 -= nr_;
+    return r1*nc_ + c; }
+
+  void getScreen(Screen &screen) const;
+
   //---
 
   virtual void loop();
@@ -54,6 +179,9 @@ class CPetBasicTerm {
   virtual std::string readString(const std::string &prompt) const;
   virtual char readChar() const;
 
+  // wait (up to usecs) for key to be available in keyboard buffer
+  virtual bool waitKey(long usecs);
+
   //---
 
   virtual void home();
@@ -84,27 +212,81 @@ class CPetBasicTerm {
   virtual bool drawChar(const uchar &c);
   virtual bool drawChar(const CPetDrawChar &drawChar);
 
+  // draw run of plain chars at cursor (wrapping and scrolling as needed)
+  virtual void drawString(const std::string &str);
+
   virtual bool drawPoint(long x, long y, long color);
 
+  // fast (non virtual) PLOT into framebuffer, shown on next redraw
+  bool plot(long x, long y, long color) {
+    if (! frameBuffer_.setPixel(x, y, color)) return plotOutside(x, y, color);
+    updatePending_ = true; return true; }
+
+  // PLOT outside framebuffer (ignored unless terminal can grow its framebuffer)
+  virtual bool plotOutside(long, long, long) { return false; }
+
+  FrameBuffer &frameBuffer() { return frameBuffer_; }
+  const FrameBuffer &frameBuffer() const { return frameBuffer_; }
+
+  //---
+
+  // update scheduler : update() requests a redraw which is coalesced and flushed
+  // at most maxUpdateRate times a second or at an explicit sync point (flush)
+  double maxUpdateRate() const { return maxUpdateRate_; }
+  void setMaxUpdateRate(double r) { maxUpdateRate_ = r; }
+
+  bool isUpdatePending() const { return updatePending_; }
+
   virtual void update();
 
+  void checkUpdate();
+
+  void flush();
+
+  virtual void redraw();
+
+  // changed cells (and old/new cursor cell) to be repainted by redraw
+  const DirtyRect &dirtyRect() const { return dirtyRect_; }
+
+  void markDirty(int r, int c);
+  void markAllDirty();
+
   //---
 
   virtual void delay(long d);
 
   virtual void enterLine();
 
+  // text of current row up to cursor (as entered by enterLine)
+  std::string lineString() const;
+
  protected:
-  using Chars = std::vector<CPetDrawChar>;
+  // count bytes written to terminal output (metrics)
+  void addBytesWritten(size_t n);
 
+  // read line (up to RETURN) from keys already in keyboard buffer (pushed or scripted)
+  bool readKeyLine(std::string &line) const;
+
+ protected:
   CPetBasic *basic_ { nullptr };
   uint       nr_    { 25 };
   uint       nc_    { 40 };
   int        r_     { 0 };
   int        c_     { 0 };
   Chars      chars_;
+  uint       topRow_ { 0 };
 
   std::string inputBuffer_;
+
+  double maxUpdateRate_  { 60.0 };  // max redraws per second (0 is unlimited)
+  bool   updatePending_  { false };
+  long   lastUpdateTime_ { 0 };     // usecs of last redraw
+
+  FrameBuffer frameBuffer_;
+
+  DirtyRect dirtyRect_;
+  int       lastCursorRow_ { -1 };
+  int       lastCursorCol_ { -1 };
 };
 
 #endif
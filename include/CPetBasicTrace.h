@@ -0,0 +1,139 @@
+#ifndef CPetBasicTrace_H
+#define CPetBasicTrace_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// binary execution trace
+//
+// Records are 8 bytes and are written to a ring of records in a memory mapped file,
+// so recording costs a store per event and the trace is kept by the OS if the
+// process dies. File layout:
+//   Header            : magic, version, capacity (records), count (records written)
+//   Record[capacity]  : record i is stored at i % capacity
+//
+// Event records:
+//   START     : run started (value is number of program statements)
+//   STATEMENT : statement run (value is flattened statement index)
+//   BRANCH    : IF evaluated (value is statement index, aux is 1 if condition true)
+//   GET       : GET result (value is key, 0 if none)
+//   INPUT     : INPUT char (value is char), INPUT_END ends each variable's line
+//   RND       : RND result (two records : low and high 32 bits of the double)
+//   TIME      : TI/TI$ read (value is jiffies)
+//
+// A trace can only be replayed if it holds the whole run (ring has not wrapped).
+class CPetBasicTrace {
+ public:
+  enum class RecordType : uint8_t {
+    NONE,
+    START,
+    STATEMENT,
+    BRANCH,
+    GET,
+    INPUT,
+    INPUT_END,
+    RND,
+    TIME
+  };
+
+  struct Record {
+    uint32_t   value { 0 };
+    uint16_t   aux   { 0 };
+    RecordType type  { RecordType::NONE };
+    uint8_t    pad   { 0 };
+  };
+
+  static_assert(sizeof(Record) == 8, "trace record size");
+
+  struct Header {
+    char     magic[8]   { };
+    uint32_t version    { 0 };
+    uint32_t recordSize { 0 };
+    uint64_t capacity   { 0 };
+    uint64_t count      { 0 }; // records written (including overwritten)
+  };
+
+  static const char *typeName(RecordType type);
+
+ public:
+  CPetBasicTrace() { }
+ ~CPetBasicTrace();
+
+  CPetBasicTrace(const CPetBasicTrace &) = delete;
+  CPetBasicTrace &operator=(const CPetBasicTrace &) = delete;
+
+  // create (or truncate) trace file of capacity records and map it for writing
+  bool create(const std::string &fileName, size_t capacity);
+
+  // read trace file (copy of records, file can still be being written)
+  bool load(const std::string &fileName);
+
+  void close();
+
+  bool isWriting() const { return header_ && writing_; }
+
+  const std::string &fileName() const { return fileName_; }
+
+  //---
+
+  void add(RecordType type, uint32_t value, uint16_t aux=0) {
+    auto &record = records_[header_->count % header_->capacity];
+
+    record.value = value;
+    record.aux   = aux;
+    record.type  = type;
+
+    ++header_->count;
+  }
+
+  void addDouble(RecordType type, double r);
+
+  //---
+
+  size_t capacity() const { return (header_ ? size_t(header_->capacity) : 0); }
+  size_t count   () const { return (header_ ? size_t(header_->count   ) : 0); }
+
+  // index of oldest record still in ring
+  size_t firstInd() const { return (count() > capacity() ? count() - capacity() : 0); }
+
+  bool isWrapped() const { return count() > capacity(); }
+
+  // record at absolute index (firstInd() <= i < count())
+  const Record &record(size_t i) const { return records_[i % header_->capacity]; }
+
+  //---
+
+  // sequential read (replay)
+  void rewind() { readInd_ = firstInd(); }
+
+  bool atEnd() const { return readInd_ >= count(); }
+
+  size_t readInd() const { return readInd_; }
+
+  bool next(Record &record);
+
+  bool nextDouble(RecordType type, double &r);
+
+  //---
+
+  const std::string &errorMsg() const { return errorMsg_; }
+
+ private:
+  static const uint32_t s_version = 1;
+
+  std::string         fileName_;
+  bool                writing_ { false };
+  int                 fd_      { -1 };      // mapped file (writing)
+  void*               map_     { nullptr };
+  size_t              mapSize_ { 0 };
+  Header*             header_  { nullptr }; // mapped or loaded header
+  Record*             records_ { nullptr }; // mapped or loaded records
+  Header              loadHeader_;
+  std::vector<Record> loadRecords_;
+  size_t              readInd_ { 0 };
+  std::string         errorMsg_;
+};
+
+#endif
@@ -1,6 +1,9 @@
 #ifndef CPetBasicUtil_H
 #define CPetBasicUtil_H
 
+#include <chrono>
+#include <string>
+
 namespace CPetBasicUtil {
 
 inline std::string toUpper(const std::string &str) {
@@ -9,6 +12,20 @@ inline std::string toUpper(const std::string &str) {
   return ustr;
 }
 
+// monotonic time in micro seconds
+inline long currentUSecs() {
+  using namespace std::chrono;
+
+  return long(duration_cast<microseconds>(steady_clock::now().time_since_epoch()).count());
+}
+
+// monotonic time in nano seconds
+inline long currentNSecs() {
+  using namespace std::chrono;
+
+  return long(duration_cast<nanoseconds>(steady_clock::now().time_since_epoch()).count());
+}
+
 }
 
 #endif
@@ -26,6 +26,9 @@ class CExprValue {
 
   CExprValue *dup() const;
 
+  // number of values created (for metrics)
+  static long numCreated();
+
   bool isBooleanValue() const;
   bool isIntegerValue() const;
   bool isRealValue   () const;
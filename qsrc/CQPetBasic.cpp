@@ -2,18 +2,28 @@
 #include <CQPetBasicTerm.h>
 #include <CQPetBasicApp.h>
 #include <CPetBasic.h>
+#include <CPetBasicUtil.h>
 #include <CQUtil.h>
+#include <CExpr.h>
 
 #include <QApplication>
-#include <QEventLoop>
 #include <QTabWidget>
 
+#include <algorithm>
+#include <chrono>
+
 CQPetBasic::
 CQPetBasic(CQPetBasicApp *app) :
  app_(app)
 {
 }
 
+CQPetBasic::
+~CQPetBasic()
+{
+  stopThread();
+}
+
 void
 CQPetBasic::
 resize(uint nr, uint nc)
@@ -31,7 +41,13 @@ setReverse(bool b)
 {
   CPetBasic::setReverse(b);
 
-  app_->updateInterface();
+  if (isWorkerThread()) {
+    Event event;
+    event.type = EventType::INTERFACE_CHANGED;
+    postEvent(std::move(event));
+  }
+  else
+    app_->updateInterface();
 }
 
 void
@@ -40,33 +56,446 @@ setShift(bool b)
 {
   CPetBasic::setShift(b);
 
-  app_->updateInterface();
+  if (isWorkerThread()) {
+    Event event;
+    event.type = EventType::INTERFACE_CHANGED;
+    postEvent(std::move(event));
+  }
+  else
+    app_->updateInterface();
 }
 
 void
 CQPetBasic::
 notifyRunLine(uint n) const
 {
-  app_->setStatusMsg(QString("Line %1").arg(n));
+  if (isWorkerThread()) {
+    Event event;
+    event.type    = EventType::RUN_LINE;
+    event.lineNum = n;
+    postEvent(std::move(event));
+  }
+  else
+    app_->setStatusMsg(QString("Line %1").arg(n));
 }
 
 void
 CQPetBasic::
 notifyLinesChanged()
 {
-  app_->notifyLinesChanged();
+  if (isWorkerThread()) {
+    Event event;
+    event.type = EventType::LINES_CHANGED;
+    postEvent(std::move(event));
+  }
+  else
+    app_->notifyLinesChanged();
 }
 
 void
 CQPetBasic::
 notifyLineNumChanged()
 {
-  app_->notifyLineNumChanged();
+  if (isWorkerThread()) {
+    Event event;
+    event.type     = EventType::LINE_NUM_CHANGED;
+    event.position = currentPosition();
+    postEvent(std::move(event));
+  }
+  else {
+    position_ = currentPosition();
+
+    app_->notifyLineNumChanged();
+  }
+}
+
+void
+CQPetBasic::
+notifyVariablesChanged(const VariableChanges &changes)
+{
+  if (isWorkerThread()) {
+    Event event;
+    event.type      = EventType::VARIABLES_CHANGED;
+    event.variables = changes;
+    getVariableValues(changes, event.values);
+    postEvent(std::move(event));
+  }
+  else
+    app_->notifyVariablesChanged(changes);
+}
+
+//---
+
+void
+CQPetBasic::
+startThread()
+{
+  if (thread_.joinable())
+    return;
+
+  quit_ = false;
+
+  thread_ = std::thread([this]() { threadLoop(); });
+
+  threadId_ = thread_.get_id();
+}
+
+void
+CQPetBasic::
+stopThread()
+{
+  if (! thread_.joinable())
+    return;
+
+  // stop current command and tell worker to exit
+  quit_ = true;
+
+  setStopped(true);
+
+  waitCond_.notify_one();
+
+  thread_.join();
+
+  threadId_ = std::thread::id();
+}
+
+bool
+CQPetBasic::
+isWorkerThread() const
+{
+  return (threadId_ != std::thread::id() && std::this_thread::get_id() == threadId_);
+}
+
+//---
+
+void
+CQPetBasic::
+postRun()
+{
+  Command command;
+  command.type = CommandType::RUN;
+  postCommand(command);
+}
+
+void
+CQPetBasic::
+postContRun()
+{
+  Command command;
+  command.type = CommandType::CONT;
+  postCommand(command);
+}
+
+void
+CQPetBasic::
+postContRunTo(uint lineNum)
+{
+  Command command;
+  command.type    = CommandType::CONT_TO;
+  command.lineNum = lineNum;
+  postCommand(command);
+}
+
+void
+CQPetBasic::
+postStep()
+{
+  Command command;
+  command.type = CommandType::STEP;
+  postCommand(command);
+}
+
+void
+CQPetBasic::
+postInputLine(const std::string &str)
+{
+  // direct mode RUN is a resumable run (run by inputLine it would block in terminal)
+  auto ustr = CPetBasicUtil::toUpper(str);
+
+  ustr.erase(std::remove(ustr.begin(), ustr.end(), ' '), ustr.end());
+
+  if (ustr == "RUN")
+    return postRun();
+
+  // always run on worker (which owns interpreter) even for program lines as a line
+  // typed while the worker is finishing a command would race with it
+  Command command;
+  command.type = CommandType::INPUT_LINE;
+  command.str  = str;
+  postCommand(command);
+}
+
+void
+CQPetBasic::
+postCommand(const Command &command)
+{
+  if (! thread_.joinable())
+    startThread();
+
+  ++busyCount_;
+
+  if (! commands_.push(command)) {
+    --busyCount_;
+    app_->errorMsg("Command queue full");
+    return;
+  }
+
+  waitCond_.notify_one();
+}
+
+//---
+
+void
+CQPetBasic::
+threadLoop()
+{
+  while (! quit_) {
+    Command command;
+
+    if (! commands_.pop(command)) {
+      std::unique_lock<std::mutex> lock(waitMutex_);
+
+      // timeout guards against missed wakeup (push and notify are not under the lock)
+      waitCond_.wait_for(lock, std::chrono::milliseconds(50));
+
+      continue;
+    }
+
+    execCommand(command);
+
+    // publish final screen and state
+    term()->flush();
+
+    flushNotify();
+
+    Event event;
+    event.type = EventType::STOPPED;
+    postEvent(std::move(event));
+
+    // GUI can only use interpreter state once everything is published
+    --busyCount_;
+  }
+}
+
+void
+CQPetBasic::
+execCommand(const Command &command)
+{
+  switch (command.type) {
+    case CommandType::RUN:
+      // discard keys typed before run
+      clearKeys();
+      setStopped(false);
+      startRun();
+      runSlices();
+
+      if (! isWaiting() && term()->col() > 0)
+        term()->enter();
+
+      break;
+    case CommandType::CONT:
+      runSlices();
+      break;
+    case CommandType::CONT_TO:
+      setResumable(true);
+      contRunTo(command.lineNum);
+      setResumable(false);
+
+      if (isWaiting())
+        runSlices();
+
+      break;
+    case CommandType::STEP:
+      step();
+      break;
+    case CommandType::INPUT_LINE:
+      setStopped(false);
+      inputLine(command.str);
+      break;
+    default:
+      break;
+  }
+}
+
+void
+CQPetBasic::
+runSlices()
+{
+  while (! quit_) {
+    auto status = runFor(0, sliceUSecs);
+
+    if (status == RunStatus::RUNNING)
+      continue;
+
+    if (status != RunStatus::WAITING)
+      break;
+
+    // sleep until suspended statement can resume
+    while (! canResume()) {
+      // stopped while waiting : stay suspended so CONT resumes statement
+      if (isStopped()) {
+        setStopped(false);
+        return;
+      }
+
+      if (waitType() == WaitType::DELAY)
+        (void) waitStopped(waitRemaining());
+      else
+        (void) waitKey(idleWait());
+    }
+  }
+}
+
+//---
+
+void
+CQPetBasic::
+postScreen(const CPetBasicTerm *term) const
+{
+  Event event;
+  event.type = EventType::SCREEN;
+  term->getScreen(event.screen);
+  postEvent(std::move(event));
+}
+
+void
+CQPetBasic::
+postEvent(Event &&event) const
+{
+  // wait for GUI to drain queue (screen events carry dirty cells so can't be dropped)
+  while (! events_.push(std::move(event))) {
+    if (quit_)
+      return;
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+}
+
+CQPetBasic::Position
+CQPetBasic::
+currentPosition() const
+{
+  Position position;
+
+  position.lineInd      = lineInd();
+  position.lineNum      = currentLineNum();
+  position.statementNum = statementNum();
+
+  return position;
+}
+
+void
+CQPetBasic::
+getVariableValues(const VariableChanges &changes, VariableValues &values) const
+{
+  auto valueString = [](const CExprValuePtr &val) {
+    std::string s;
+    if (val && val->getStringValue(s))
+      return s;
+    return std::string();
+  };
+
+  //---
+
+  values.reset = changes.reset;
+
+  if (changes.reset)
+    getVariableNames(values.names, values.arrayNames);
+  else {
+    values.names     .assign(changes.names     .begin(), changes.names     .end());
+    values.arrayNames.assign(changes.arrayNames.begin(), changes.arrayNames.end());
+  }
+
+  for (const auto &name : values.names)
+    values.values[name] = valueString(getVariableValue(name));
+
+  for (const auto &name : values.arrayNames) {
+    auto &arrayValues = values.arrayValues[name];
+
+    getArrayDims(name, arrayValues.dims);
+
+    uint n = (arrayValues.dims.empty() ? 0 : 1);
+
+    for (const auto &dim : arrayValues.dims)
+      n *= dim;
+
+    n = std::min(n, maxArrayValues);
+
+    for (uint i = 0; i < n; ++i)
+      arrayValues.values.push_back(valueString(getArrayValue(name, i)));
+  }
 }
 
 void
 CQPetBasic::
-notifyVariablesChanged()
+processEvents()
 {
-  app_->notifyVariablesChanged();
+  bool runLine = false, interfaceChanged = false, positionChanged = false;
+
+  uint lineNum = 0;
+
+  // coalesce all pending events and apply most recent state
+  Event event;
+
+  while (events_.pop(event)) {
+    switch (event.type) {
+      case EventType::RUN_LINE:
+        runLine = true; lineNum = event.lineNum; break;
+      case EventType::LINE_NUM_CHANGED:
+        position_ = event.position; positionChanged = lineNumChanged_ = true; break;
+      case EventType::LINES_CHANGED:
+        linesChanged_ = true; break;
+      case EventType::VARIABLES_CHANGED:
+        // show worker's values now, re-read changed variables when idle
+        app_->notifyVariableValues(event.values);
+
+        variableChanges_.add(event.variables); break;
+      case EventType::INTERFACE_CHANGED:
+        interfaceChanged = true; break;
+      case EventType::SCREEN:
+        app_->term()->setScreen(std::move(event.screen)); break;
+      case EventType::STOPPED:
+        linesChanged_ = lineNumChanged_ = true; break;
+      default:
+        break;
+    }
+  }
+
+  if (runLine)
+    app_->setStatusMsg(QString("Line %1").arg(lineNum));
+
+  if (interfaceChanged)
+    app_->updateInterface();
+
+  // views follow the published position while running (they only read the position
+  // snapshot while busy, anything else reading interpreter state waits for idle)
+  if (isBusy()) {
+    if (positionChanged)
+      app_->notifyLineNumChanged();
+
+    return;
+  }
+
+  if (linesChanged_) {
+    linesChanged_ = false;
+
+    app_->notifyLinesChanged();
+  }
+
+  if (lineNumChanged_) {
+    lineNumChanged_ = false;
+
+    position_ = currentPosition();
+
+    app_->notifyLineNumChanged();
+  }
+
+  // variable view only updates changed rows
+  if (variableChanges_.isSet()) {
+    auto changes = std::move(variableChanges_);
+
+    variableChanges_.clear();
+
+    app_->notifyVariablesChanged(changes);
+  }
 }
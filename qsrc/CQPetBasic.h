@@ -2,14 +2,96 @@
 #define CQPetBasic_H
 
 #include <CPetBasic.h>
+#include <CPetBasicTerm.h>
+#include <CPetBasicQueue.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
 
 class CQPetBasicApp;
 
 //---
 
+// Basic interpreter for Qt application
+//
+// The interpreter (run, step, direct mode commands) runs on a worker thread so the
+// GUI stays responsive. The GUI thread posts commands and key presses to the worker
+// and the worker posts notifications and screen snapshots back to the GUI. Both
+// directions use lock free single producer/consumer queues.
+//
+// Program runs are resumable and run in time slices (runFor) so INPUT, GET and DELAY
+// suspend the run and the worker sleeps until a key is pushed, the delay ends or the
+// run is stopped (instead of blocking in the terminal).
+//
+// While the worker is busy it owns the interpreter and terminal state so the GUI
+// must only use the queues (postXXX, pushKey), setStopped (stopped flag is atomic),
+// the last screen snapshot and the last published position.
 class CQPetBasic : public CPetBasic {
+ public:
+  enum class CommandType {
+    NONE,
+    RUN,
+    CONT,
+    CONT_TO,
+    STEP,
+    INPUT_LINE
+  };
+
+  struct Command {
+    CommandType type    { CommandType::NONE };
+    uint        lineNum { 0 };
+    std::string str;
+  };
+
+  enum class EventType {
+    NONE,
+    RUN_LINE,
+    LINE_NUM_CHANGED,
+    LINES_CHANGED,
+    VARIABLES_CHANGED,
+    INTERFACE_CHANGED,
+    SCREEN,
+    STOPPED
+  };
+
+  // current position (published by worker so views can follow a run)
+  struct Position {
+    int  lineInd      { -1 };
+    int  lineNum      { -1 };
+    uint statementNum { 0 };
+  };
+
+  // formatted values of changed variables (made by worker so variables view can
+  // follow a run). Arrays only have the first maxArrayValues element values.
+  struct ArrayValues {
+    Inds                     dims;
+    std::vector<std::string> values;
+  };
+
+  struct VariableValues {
+    bool                               reset { false };
+    std::vector<std::string>           names;      // all names (reset)
+    std::vector<std::string>           arrayNames; // all array names (reset)
+    std::map<std::string, std::string> values;
+    std::map<std::string, ArrayValues> arrayValues;
+  };
+
+  static constexpr uint maxArrayValues = 256;
+
+  struct Event {
+    EventType             type    { EventType::NONE };
+    uint                  lineNum { 0 };
+    Position              position;
+    CPetBasicTerm::Screen screen;
+    VariableChanges       variables;
+    VariableValues        values;
+  };
+
  public:
   CQPetBasic(CQPetBasicApp *term);
+ ~CQPetBasic();
 
   void resize(uint nr, uint nc) override;
 
@@ -22,10 +104,75 @@ class CQPetBasic : public CPetBasic {
   void notifyLinesChanged() override;
   void notifyLineNumChanged() override;
 
-  void notifyVariablesChanged() override;
+  void notifyVariablesChanged(const VariableChanges &changes) override;
+
+  //---
+
+  // worker thread
+  void startThread();
+  void stopThread();
+
+  bool isWorkerThread() const;
+
+  // true if worker is running (or has pending) commands
+  bool isBusy() const { return busyCount_ > 0; }
+
+  // last published position (GUI thread, valid while busy)
+  const Position &position() const { return position_; }
+
+  // post commands to worker (GUI thread)
+  void postRun();
+  void postContRun();
+  void postContRunTo(uint lineNum);
+  void postStep();
+  void postInputLine(const std::string &str);
+
+  // process events posted by worker (GUI thread)
+  void processEvents();
+
+  // post screen snapshot to GUI (worker thread)
+  void postScreen(const CPetBasicTerm *term) const;
+
+ private:
+  void postCommand(const Command &command);
+
+  void postEvent(Event &&event) const;
+
+  Position currentPosition() const;
+
+  void getVariableValues(const VariableChanges &changes, VariableValues &values) const;
+
+  void threadLoop();
+
+  void execCommand(const Command &command);
+
+  void runSlices();
 
  private:
+  using CommandQueue = CPetBasicQueue<Command, 64>;
+  using EventQueue   = CPetBasicQueue<Event, 256>;
+
+  static constexpr long sliceUSecs = 50000; // run slice time
+
   CQPetBasicApp *app_ { nullptr };
+
+  std::thread             thread_;
+  std::thread::id         threadId_;
+  std::mutex              waitMutex_;
+  std::condition_variable waitCond_;
+
+  CommandQueue       commands_;
+  mutable EventQueue events_;
+
+  Position position_;
+
+  // changes received while busy (applied to views when idle)
+  VariableChanges variableChanges_;
+  bool            linesChanged_   { false };
+  bool            lineNumChanged_ { false };
+
+  std::atomic<int>  busyCount_ { 0 };
+  std::atomic<bool> quit_      { false };
 };
 
 #endif
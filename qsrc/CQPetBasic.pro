@@ -13,6 +13,8 @@ MOC_DIR = .moc
 
 CONFIG += c++17
 
+DEFINES += PET_EXTRA_KEYWORDS
+
 SOURCES += \
 main.cpp \
 CQPetBasicApp.cpp \
@@ -22,6 +24,7 @@ CQPetBasicDbg.cpp \
 CQPetBasicKeyboard.cpp \
 CQPetBasicStatus.cpp \
 CQPetBasicTerm.cpp \
+CQPetBasicTrace.cpp \
 CQPetBasicVariables.cpp \
 CQCommand.cpp \
 
@@ -33,6 +36,7 @@ CQPetBasicDbg.h \
 CQPetBasicKeyboard.h \
 CQPetBasicStatus.h \
 CQPetBasicTerm.h \
+CQPetBasicTrace.h \
 CQPetBasicVariables.h \
 CQCommand.h \
 
@@ -73,4 +77,4 @@ unix:LIBS += \
 -lCQModelView -lCQBaseModel -lCQUtil -lCReadLine \
 -lCFont -lCImageLib -lCConfig -lCUtil \
 -lCFileUtil -lCFile -lCMath -lCStrUtil -lCRegExp -lCOS \
--lpng -ljpeg -ltre -lreadline -lcurses
+-lpng -ljpeg -ltre -lreadline -lcurses -lrt
@@ -2,6 +2,7 @@
 #include <CQPetBasicTerm.h>
 #include <CQPetBasicDbg.h>
 #include <CQPetBasicVariables.h>
+#include <CQPetBasicTrace.h>
 #include <CQPetBasicKeyboard.h>
 #include <CQPetBasicCommand.h>
 #include <CQPetBasicStatus.h>
@@ -10,6 +11,7 @@
 #include <CQUtil.h>
 
 #include <QApplication>
+#include <QTimer>
 
 CQPetBasicApp::
 CQPetBasicApp(QWidget *parent) :
@@ -61,6 +63,10 @@ CQPetBasicApp(QWidget *parent) :
 
   debugTab_->addTab(variables_, "Variables");
 
+  trace_ = new CQPetBasicTrace(this);
+
+  debugTab_->addTab(trace_, "Trace");
+
   debugTab_->setVisible(false);
 
   //---
@@ -91,6 +97,24 @@ CQPetBasicApp(QWidget *parent) :
   status_ = new CQPetBasicStatus(this);
 
   layout->addWidget(status_);
+
+  //---
+
+  // start interpreter thread and poll for its events (screen updates, notifications)
+  basic_->startThread();
+
+  eventsTimer_ = new QTimer(this);
+
+  CQUtil::defConnect(eventsTimer_, this, SLOT(eventsTimeout()));
+
+  eventsTimer_->start(16);
+}
+
+void
+CQPetBasicApp::
+eventsTimeout()
+{
+  basic_->processEvents();
 }
 
 bool
@@ -137,11 +161,10 @@ setDebugVisible(bool b)
 
 void
 CQPetBasicApp::
-setStatusMsg(const QString & /*msg*/)
+setStatusMsg(const QString &msg)
 {
-  //status_->setText(msg);
-
-  qApp->processEvents();
+  // called at a bounded rate (see CPetBasic::checkNotify)
+  status_->setText(msg);
 }
 
 void
@@ -156,7 +179,7 @@ void
 CQPetBasicApp::
 notifyLinesChanged()
 {
-  dbg_->file()->requestUpdate();
+  dbg_->file()->invalidateLines();
 }
 
 void
@@ -165,14 +188,25 @@ notifyLineNumChanged()
 {
   dbg_->scrollVisible();
 
-  dbg_->file()->requestUpdate();
+  dbg_->file()->updateCurrentLine();
+
+  dbg_->file()->updateHeat();
+
+  trace_->updateTrace();
+}
+
+void
+CQPetBasicApp::
+notifyVariablesChanged(const CPetBasic::VariableChanges &changes)
+{
+  variables_->applyChanges(changes);
 }
 
 void
 CQPetBasicApp::
-notifyVariablesChanged()
+notifyVariableValues(const CQPetBasic::VariableValues &values)
 {
-  variables_->reload();
+  variables_->applyValues(values);
 }
 
 void
@@ -1,6 +1,7 @@
 #ifndef CQPetBasicApp_H
 #define CQPetBasicApp_H
 
+#include <CQPetBasic.h>
 #include <QWidget>
 
 class CQPetBasicTerm;
@@ -9,7 +10,7 @@ class CQPetBasicCommandScroll;
 class CQPetBasicStatus;
 class CQPetBasicDbg;
 class CQPetBasicVariables;
-class CQPetBasic;
+class CQPetBasicTrace;
 
 class QTabWidget;
 class QTimer;
@@ -44,19 +45,26 @@ class CQPetBasicApp : public QWidget {
   void notifyLinesChanged();
   void notifyLineNumChanged();
 
-  void notifyVariablesChanged();
+  void notifyVariablesChanged(const CPetBasic::VariableChanges &changes);
+
+  void notifyVariableValues(const CQPetBasic::VariableValues &values);
 
   void errorMsg(const QString &msg);
 
+ private Q_SLOTS:
+  void eventsTimeout();
+
  private:
-  CQPetBasic*              basic_     { nullptr };
-  CQPetBasicTerm*          term_      { nullptr };
-  CQPetBasicKeyboard*      keyboard_  { nullptr };
-  CQPetBasicCommandScroll* command_   { nullptr };
-  QTabWidget*              debugTab_  { nullptr };
-  CQPetBasicDbg*           dbg_       { nullptr };
-  CQPetBasicVariables*     variables_ { nullptr };
-  CQPetBasicStatus*        status_    { nullptr };
+  CQPetBasic*              basic_       { nullptr };
+  CQPetBasicTerm*          term_        { nullptr };
+  CQPetBasicKeyboard*      keyboard_    { nullptr };
+  CQPetBasicCommandScroll* command_     { nullptr };
+  QTabWidget*              debugTab_    { nullptr };
+  CQPetBasicDbg*           dbg_         { nullptr };
+  CQPetBasicVariables*     variables_   { nullptr };
+  CQPetBasicTrace*         trace_       { nullptr };
+  CQPetBasicStatus*        status_      { nullptr };
+  QTimer*                  eventsTimer_ { nullptr };
 };
 
 #endif
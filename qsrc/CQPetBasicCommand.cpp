@@ -36,7 +36,7 @@ executeCommandSlot(const QString &cmd)
   else {
     auto *basic = app_->basic();
 
-    basic->inputLine(cmd.toStdString());
+    basic->postInputLine(cmd.toStdString());
   }
 }
 
@@ -44,12 +44,14 @@ void
 CQPetBasicCommandScroll::
 keyPressSlot(const QString &str)
 {
-  auto *term = app_->term();
+  auto *term  = app_->term();
+  auto *basic = app_->basic();
 
-  if (term->isLooping() && term->isLoopChar() && str.length()) {
+  // while running (and not reading a string) keys go to keyboard buffer for GET
+  if (basic->isBusy() && ! term->isLooping() && str.length()) {
     command()->clearEntry();
 
-    term->enterLoopStr(str.toStdString());
+    basic->pushKeys(str.toStdString());
   }
 }
 
@@ -8,9 +8,12 @@
 
 #include <QPainter>
 #include <QApplication>
+#include <QCheckBox>
 #include <QToolButton>
 #include <QVBoxLayout>
 #include <QMouseEvent>
+#include <QPaintEvent>
+#include <algorithm>
 #include <cmath>
 
 #include <svg/play_svg.h>
@@ -59,6 +62,14 @@ CQPetBasicDbg(CQPetBasic *basic) :
   toolbarLayout->addWidget(playButton_ );
   toolbarLayout->addWidget(pauseButton_);
   toolbarLayout->addWidget(stepButton_ );
+
+  profileCheck_ = CQUtil::makeLabelWidget<QCheckBox>("Profile", "profile");
+
+  profileCheck_->setToolTip("Profile line execution count and time");
+
+  connect(profileCheck_, SIGNAL(stateChanged(int)), this, SLOT(profileSlot(int)));
+
+  toolbarLayout->addWidget(profileCheck_);
   toolbarLayout->addStretch();
 
   layout->addWidget(toolbarFrame);
@@ -78,7 +89,7 @@ CQPetBasicDbg::
 scrollVisible()
 {
   if (isVisible()) {
-    int lineInd = basic_->lineInd();
+    int lineInd = basic_->position().lineInd;
 
     auto pos = file_->lineIndPos(lineInd);
 
@@ -99,12 +110,7 @@ void
 CQPetBasicDbg::
 playSlot()
 {
-  auto lineNum = file_->markerLineNum();
-
-  if (lineNum > 0)
-    basic_->contRunTo(lineNum);
-  else
-    basic_->contRun();
+  basic_->postContRun();
 }
 
 void
@@ -118,7 +124,21 @@ void
 CQPetBasicDbg::
 stepSlot()
 {
-  basic_->step();
+  basic_->postStep();
+}
+
+void
+CQPetBasicDbg::
+profileSlot(int state)
+{
+  if (basic_->isBusy())
+    return;
+
+  basic_->setProfile(state == Qt::Checked);
+
+  basic_->clearProfile();
+
+  file_->updateHeat();
 }
 
 void
@@ -140,16 +160,6 @@ CQPetBasicFileView(CQPetBasicDbg *dbg) :
   setFont(font);
 }
 
-int
-CQPetBasicFileView::
-markerLineNum() const
-{
-  if (markers_.empty())
-    return -1;
-
-  return *markers_.begin();
-}
-
 QPoint
 CQPetBasicFileView::
 lineIndPos(int lineInd) const
@@ -163,18 +173,25 @@ mouseDoubleClickEvent(QMouseEvent *e)
 {
   int r = (e->y() - offset_.y())/th_;
   int c = (e->x() - offset_.x())/tw_;
-  if (r < 0 || c < 0) return;
+  if (r < 0 || c < 0 || r >= int(lineTexts_.size())) return;
 
   auto *basic = dbg_->basic();
 
-  auto *lineData = basic->getLineIndData(uint(r));
-  if (! lineData) return;
+  // break points belong to the worker while it is running
+  if (basic->isBusy()) return;
 
-  markers_.clear();
+  auto &lineText = lineTexts_[size_t(r)];
+  if (lineText.lineN == 0) return;
 
-  markers_.insert(lineData->lineN);
+  // toggle break point on first statement of line
+  if (basic->hasBreakpoint(lineText.lineN))
+    basic->removeBreakpoint(lineText.lineN);
+  else
+    basic->addBreakpoint(lineText.lineN);
+
+  lineText.marked = basic->hasBreakpoint(lineText.lineN);
 
-  update();
+  update(lineIndRect(r));
 }
 
 void
@@ -187,141 +204,310 @@ requestUpdate()
 
 void
 CQPetBasicFileView::
-paintEvent(QPaintEvent *)
+invalidateLines()
+{
+  // lines belong to the worker while it is running (rebuilt when it stops)
+  if (dbg_->basic()->isBusy())
+    return;
+
+  updateLines();
+
+  updateHeat();
+
+  requestUpdate();
+}
+
+void
+CQPetBasicFileView::
+updateCurrentLine()
+{
+  auto lineInd = dbg_->basic()->position().lineInd;
+
+  if (lineInd == currentLineInd_)
+    return;
+
+  if (isVisible()) {
+    update(lineIndRect(currentLineInd_));
+    update(lineIndRect(lineInd));
+  }
+
+  currentLineInd_ = lineInd;
+}
+
+void
+CQPetBasicFileView::
+updateHeat()
 {
   auto *basic = dbg_->basic();
 
-  auto currentLineNum = basic->currentLineNum();
+  // profile data belongs to the worker while it is running
+  if (basic->isBusy())
+    return;
 
-  QPainter painter(this);
+  auto heatMax = heatMax_;
+  auto profile = profile_;
 
-  painter.fillRect(rect(), Qt::white);
+  profile_ = basic->isProfile();
+  heatMax_ = 0;
 
-  QFontMetrics fm(font());
+  CPetBasic::ProfileData data;
 
-  tw_ = fm.horizontalAdvance("X");
-  th_ = fm.height();
-  ta_ = fm.ascent();
+  for (auto &lineText : lineTexts_) {
+    lineText.heat = 0;
 
-  auto nl = basic->maxLine();
+    if (profile_ && lineText.lineN > 0 && basic->getLineProfile(lineText.lineN, data))
+      lineText.heat = data.nsecs;
 
-  uint lw = uint(std::log10(nl) + 1);
+    heatMax_ = std::max(heatMax_, lineText.heat);
+  }
 
-  int y = offset_.y();
+  if (heatMax_ != heatMax || heatMax_ > 0 || profile_ != profile)
+    requestUpdate();
+}
 
-  maxLineLen_ = lw + 1;
+QRect
+CQPetBasicFileView::
+lineIndRect(int lineInd) const
+{
+  return QRect(0, offset_.y() + th_*lineInd, width(), th_);
+}
 
-  for (const auto &pl : basic->getLines()) {
-    const auto &lineData = pl.second;
+void
+CQPetBasicFileView::
+updateLines()
+{
+  auto *basic = dbg_->basic();
 
-    auto isCurrent = (currentLineNum > 0 && lineData.lineN == uint(currentLineNum));
+  auto nl = basic->numLines();
 
-    //---
+  lineTexts_.clear();
+  lineTexts_.resize(nl);
 
-    int x = offset_.x();
+  lineNumWidth_ = uint(std::log10(std::max(basic->maxLine(), 1U)) + 1);
 
-    //---
+  maxLineLen_ = 80;
 
-    auto lineNumStr = QString::number(lineData.lineN);
+  for (uint lineInd = 0; lineInd < nl; ++lineInd) {
+    auto *lineData = basic->getLineIndData(lineInd);
+    if (! lineData) continue;
 
-    while (uint(lineNumStr.size()) < lw)
-      lineNumStr = " " + lineNumStr;
+    auto &lineText = lineTexts_[lineInd];
 
-    auto marked = (markers_.find(lineData.lineN) != markers_.end());
+    lineText.lineN  = lineData->lineN;
+    lineText.marked = basic->hasBreakpoint(lineData->lineN);
 
-    if      (marked)
-      painter.setPen(dbg_->markColor());
-    else if (isCurrent) {
-      painter.fillRect(QRect(x, y, tw_*lw, th_), dbg_->currentColor());
+    addLineSpans(lineText, lineData);
 
-      painter.setPen(dbg_->bgColor());
+    maxLineLen_ = std::max(maxLineLen_, uint(lineNumWidth_ + 1 + lineText.len));
+  }
+
+  Q_EMIT updateSize(dataSize());
+}
+
+void
+CQPetBasicFileView::
+addLineSpans(LineText &lineText, const CPetBasic::LineData *lineData) const
+{
+  auto addString = [&](const std::string &str, const QColor &c) {
+    auto qstr = QString::fromStdString(str);
+
+    // merge with previous span of same color
+    if (! lineText.spans.empty() && lineText.spans.back().color == c) {
+      auto &span = lineText.spans.back();
+
+      span.text.setText(span.text.text() + qstr);
     }
-    else
-      painter.setPen(dbg_->fgColor());
+    else {
+      LineSpan span;
 
-    painter.drawText(x, y + ta_, lineNumStr);
+      span.text.setText(qstr);
+      span.color = c;
 
-    x += (lw + 1)*tw_;
+      lineText.spans.push_back(span);
+    }
 
-    //---
+    lineText.len += uint(str.size());
+  };
 
-    std::string lineStr;
-    QColor      currentPen;
-    bool        needsSpace = false;
+  bool needsSpace = false;
 
-    auto drawString = [&](const std::string &str, const QColor &c) {
-      if (currentPen != c) {
-        currentPen = c;
+  auto addSpace = [&]() {
+    if (needsSpace) {
+      addString(" ", dbg_->fgColor());
 
-        painter.setPen(currentPen);
-      }
+      needsSpace = false;
+    }
+  };
 
-      lineStr += str;
+  //---
 
-      painter.drawText(x, y + ta_, QString::fromStdString(str));
+  uint is = 0;
 
-      x += fm.horizontalAdvance(QString::fromStdString(str));
-    };
+  for (const auto &statement : lineData->statements) {
+    if (is > 0)
+      addString(":", dbg_->fgColor());
 
-    auto addSpace = [&]() {
-      if (needsSpace) {
-        drawString(" ", dbg_->fgColor());
+    for (auto *token : statement.tokens) {
+      if      (token->type() == CPetBasic::TokenType::STRING) {
+        addSpace();
 
-        needsSpace = false;
+        addString("\"" + CPetBasic::decodeEmbeddedStr(token->toString()) + "\"",
+                  dbg_->stringColor());
       }
-    };
+      else if (token->type() == CPetBasic::TokenType::KEYWORD) {
+        addSpace();
 
-    //---
+        addString(token->exprString(), dbg_->keywordColor());
 
-    uint is = 0;
+        if (token->toString() != "")
+          addString(" " + token->toString(), dbg_->fgColor());
+        else
+          needsSpace = true;
+      }
+      else if (token->type() == CPetBasic::TokenType::OPERATOR) {
+        addSpace();
 
-    for (const auto &statement : lineData.statements) {
-      if (is > 0)
-        drawString(":", dbg_->fgColor());
+        auto str = token->toString();
 
-      for (auto *token : statement.tokens) {
-        if      (token->type() == CPetBasic::TokenType::STRING) {
-          addSpace();
+        addString(str, dbg_->operatorColor());
+
+        if (isalpha(str[0]))
+          needsSpace = true;
+      }
+      else {
+        auto str = token->toString();
 
-          drawString("\"" + CPetBasic::decodeEmbeddedStr(token->toString()) + "\"",
-                     dbg_->stringColor());
-        }
-        else if (token->type() == CPetBasic::TokenType::KEYWORD) {
+        if (! str.empty() && str[0] != ' ')
           addSpace();
 
-          drawString(token->exprString(), dbg_->keywordColor());
+        addString(token->toString(), dbg_->fgColor());
+      }
+    }
 
-          if (token->toString() != "")
-            drawString(" " + token->toString(), dbg_->fgColor());
-          else
-            needsSpace = true;
-        }
-        else if (token->type() == CPetBasic::TokenType::OPERATOR) {
-          addSpace();
+    ++is;
+  }
+}
 
-          auto str = token->toString();
+const CQPetBasicFileView::LineText &
+CQPetBasicFileView::
+lineText(uint lineInd) const
+{
+  auto &lineText = lineTexts_[lineInd];
 
-          drawString(str, dbg_->operatorColor());
+  if (lineText.prepared)
+    return lineText;
 
-          if (isalpha(str[0]))
-            needsSpace = true;
-        }
-        else {
-          auto str = token->toString();
+  lineText.prepared = true;
 
-          if (! str.empty() && str[0] != ' ')
-            addSpace();
+  if (lineText.lineN == 0)
+    return lineText;
 
-          drawString(token->toString(), dbg_->fgColor());
-        }
-      }
+  //---
+
+  auto lineNumStr = QString::number(lineText.lineN);
+
+  while (uint(lineNumStr.size()) < lineNumWidth_)
+    lineNumStr = " " + lineNumStr;
+
+  lineText.lineNumText.setText(lineNumStr);
+  lineText.lineNumText.prepare(QTransform(), font());
+
+  //---
+
+  QFontMetrics fm(font());
+
+  int x = 0;
+
+  for (auto &span : lineText.spans) {
+    span.x = x;
+
+    span.text.prepare(QTransform(), font());
+
+    x += fm.horizontalAdvance(span.text.text());
+  }
+
+  return lineText;
+}
 
-      ++is;
+void
+CQPetBasicFileView::
+paintEvent(QPaintEvent *e)
+{
+  // only uses line snapshot and published position (worker may be running)
+  const auto &position = dbg_->basic()->position();
+
+  auto currentLineNum = position.lineNum;
+
+  currentLineInd_ = position.lineInd;
+
+  QPainter painter(this);
+
+  painter.fillRect(e->rect(), Qt::white);
+
+  painter.setFont(font());
+
+  QFontMetrics fm(font());
+
+  tw_ = fm.horizontalAdvance("X");
+  th_ = fm.height();
+  ta_ = fm.ascent();
+
+  auto lw = lineNumWidth_;
+
+  // heat map gutter (profile time relative to hottest line)
+  int gw = (profile_ ? tw_ : 0);
+
+  //---
+
+  // only draw lines intersecting the exposed rect
+  int nl = int(lineTexts_.size());
+
+  int lineInd1 = std::max((e->rect().top   () - offset_.y())/th_, 0);
+  int lineInd2 = std::min((e->rect().bottom() - offset_.y())/th_, nl - 1);
+
+  for (int lineInd = lineInd1; lineInd <= lineInd2; ++lineInd) {
+    const auto &lineText = this->lineText(uint(lineInd));
+
+    auto isCurrent = (currentLineNum > 0 && lineText.lineN == uint(currentLineNum));
+
+    int x = offset_.x();
+    int y = offset_.y() + lineInd*th_;
+
+    //---
+
+    if (profile_ && heatMax_ > 0 && lineText.heat > 0) {
+      auto f = double(lineText.heat)/double(heatMax_);
+
+      auto g = int(255*(1.0 - f));
+
+      painter.fillRect(QRect(x, y, gw, th_), QColor(255, g, 0));
     }
 
-    y += th_;
+    x += gw;
 
-    maxLineLen_ = std::max(maxLineLen_, uint(lw + 1 + lineStr.size()));
+    //---
+
+    if      (lineText.marked)
+      painter.setPen(dbg_->markColor());
+    else if (isCurrent) {
+      painter.fillRect(QRect(x, y, tw_*int(lw), th_), dbg_->currentColor());
+
+      painter.setPen(dbg_->bgColor());
+    }
+    else
+      painter.setPen(dbg_->fgColor());
+
+    painter.drawStaticText(x, y, lineText.lineNumText);
+
+    x += int(lw + 1)*tw_;
+
+    //---
+
+    for (const auto &span : lineText.spans) {
+      painter.setPen(span.color);
+
+      painter.drawStaticText(x + span.x, y, span.text);
+    }
   }
 }
 
@@ -336,16 +522,14 @@ QSize
 CQPetBasicFileView::
 dataSize() const
 {
-  auto *basic = dbg_->basic();
-
   QFontMetrics fm(font());
 
   tw_ = fm.horizontalAdvance("X");
   th_ = fm.height();
 
-  auto nl = basic->numLines();
+  auto nl = int(lineTexts_.size());
 
-  return QSize(maxLineLen_*tw_, nl*th_);
+  return QSize(int(maxLineLen_)*tw_, nl*th_);
 }
 
 QSize
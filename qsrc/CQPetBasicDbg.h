@@ -1,14 +1,16 @@
 #ifndef CQPetBasicDbg_H
 #define CQPetBasicDbg_H
 
+#include <CPetBasic.h>
 #include <QFrame>
-#include <set>
+#include <QStaticText>
 
 class CQPetBasic;
 class CQPetBasicFileView;
 
 class CQScrollArea;
 class CQPixmapButton;
+class QCheckBox;
 
 class CQPetBasicDbg : public QFrame {
   Q_OBJECT
@@ -65,6 +67,8 @@ class CQPetBasicDbg : public QFrame {
   void pauseSlot();
   void stepSlot ();
 
+  void profileSlot(int state);
+
  private:
   CQPetBasic* basic_ { nullptr };
 
@@ -81,6 +85,7 @@ class CQPetBasicDbg : public QFrame {
   CQPixmapButton*     playButton_  { nullptr };
   CQPixmapButton*     pauseButton_ { nullptr };
   CQPixmapButton*     stepButton_  { nullptr };
+  QCheckBox*          profileCheck_ { nullptr };
 };
 
 //---
@@ -93,17 +98,24 @@ class CQPetBasicFileView : public QFrame {
 
   void setOffset(const QPoint &o) { offset_ = o; }
 
-  int markerLineNum() const;
-
   QPoint lineIndPos(int lineInd) const;
 
   void requestUpdate();
 
+  // rebuild line snapshot (program lines changed, deferred until idle)
+  void invalidateLines();
+
+  // repaint previous and new current line (line number changed)
+  void updateCurrentLine();
+
+  // update profile heat map gutter (when idle)
+  void updateHeat();
+
   void resizeEvent(QResizeEvent *) override;
 
   void mouseDoubleClickEvent(QMouseEvent *e) override;
 
-  void paintEvent(QPaintEvent *) override;
+  void paintEvent(QPaintEvent *e) override;
 
   QSize dataSize() const;
 
@@ -113,14 +125,48 @@ class CQPetBasicFileView : public QFrame {
   void updateSize(const QSize &);
 
  private:
-  using Markers = std::set<int>;
+  // snapshot of a source line taken when idle (paint never reads interpreter state
+  // as the worker may be running). Text is laid out when line is first painted.
+  struct LineSpan {
+    QStaticText text;
+    QColor      color;
+    int         x { 0 };
+  };
+
+  using LineSpans = std::vector<LineSpan>;
+
+  struct LineText {
+    uint        lineN    { 0 };
+    bool        marked   { false }; // has break point
+    long        heat     { 0 };     // profile time (nsecs)
+    QStaticText lineNumText;
+    LineSpans   spans;
+    uint        len      { 0 };
+    bool        prepared { false };
+  };
 
+  using LineTexts = std::vector<LineText>;
+
+  void updateLines();
+
+  void addLineSpans(LineText &lineText, const CPetBasic::LineData *lineData) const;
+
+  const LineText &lineText(uint lineInd) const;
+
+  QRect lineIndRect(int lineInd) const;
+
+ private:
   CQPetBasicDbg *dbg_ { nullptr };
 
   QPoint offset_;
   uint   maxLineLen_ { 80 };
 
-  Markers markers_;
+  mutable LineTexts lineTexts_;
+  uint              lineNumWidth_ { 1 };
+
+  int  currentLineInd_ { -1 };
+  bool profile_        { false }; // show heat map gutter
+  long heatMax_        { 0 };     // max line profile time (nsecs) for heat map
 
   mutable int tw_ { 8 };
   mutable int th_ { 8 };
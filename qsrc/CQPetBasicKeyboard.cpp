@@ -49,18 +49,13 @@ mousePressEvent(QMouseEvent *e)
   auto *term  = app_->term();
   auto *basic = term->basic();
 
-  auto sendChar = [&](const CPetDrawChar &drawChar1) {
-    if (term->isLooping()) {
-      auto c = char(drawChar1.c());
-
-      auto s = std::string(&c, 1);
-
-      if (term->isLoopChar()) {
-        term->enterLoopStr(s);
-        return;
-      }
+  // keys are read (and echoed) by interpreter thread while it is running
+  bool isBusy = basic->isBusy();
 
-      term->addLoopStr(s);
+  auto sendChar = [&](const CPetDrawChar &drawChar1) {
+    if (isBusy) {
+      basic->pushKey(uchar(drawChar1.c()));
+      return;
     }
 
     auto drawChar2 = drawChar1;
@@ -82,12 +77,38 @@ mousePressEvent(QMouseEvent *e)
 
   int i = iy_*16 + ix_;
 
+  if (i == 73) { // STOP/RUN
+    if (! basic->isShift())
+      basic->setStopped(true);
+    else if (! isBusy)
+      basic->postRun();
+    return;
+  }
+
+  if (i == 42 || i == 58) { //RETURN
+    if (isBusy)
+      basic->pushKey('\r');
+    else {
+      term->enter(); term->update();
+    }
+    return;
+  }
+
+  if (i == 15 && isBusy) { // DEL
+    basic->pushKey(20);
+    return;
+  }
+
   if (i == 64 || i == 74) { // LSHIFT/RSHIFT
     basic->setShift(! basic->isShift());
     update();
     return;
   }
 
+  // remaining control keys edit screen so ignore while running
+  if (isBusy && (i == 65 || i == 12 || i == 13 || i == 14 || i == 15))
+    return;
+
   if (i == 65) { // REV/OFF
     if (! term->inQuotes()) {
       basic->setReverse(! basic->isShift());
@@ -150,24 +171,6 @@ mousePressEvent(QMouseEvent *e)
     return;
   }
 
-  if (i == 42 || i == 58) { //RETURN
-    if (term->isLooping())
-      term->enterLoopStr("");
-    else {
-      term->enter(); term->update();
-    }
-    return;
-  }
-
-  if (i == 73) { // STOP/RUN
-    if (! basic->isShift())
-      basic->setStopped(true);
-    else
-      basic->run();
-    term->update();
-    return;
-  }
-
   //---
 
   if      (i == 69 || i == 70) {
@@ -8,10 +8,10 @@
 
 #include <QApplication>
 #include <QTimer>
-#include <QEventLoop>
 #include <QMouseEvent>
 #include <QPainter>
-#include <QTime>
+
+#include <cmath>
 
 CQPetBasicTerm::
 CQPetBasicTerm(CQPetBasicApp *app) :
@@ -48,23 +48,6 @@ init()
   CQUtil::defConnect(cursorTimer_, this, SLOT(cursorTimeout()));
 
   cursorTimer_->start(1000);
-
-  //---
-
-  // cursor blink timer
-  updateTimer_ = new QTimer(this);
-
-  CQUtil::defConnect(updateTimer_, this, SLOT(updateTimeout()));
-
-  updateTimer_->start(250);
-
-  //---
-
-  // loop timer
-  loopData_.loopTimer = new QTimer(this);
-  loopData_.loopTimer->setSingleShot(true);
-
-  CQUtil::defConnect(loopData_.loopTimer, this, SLOT(loopTimeout()));
 }
 
 CQPetBasic *
@@ -81,6 +64,8 @@ resize(uint nr, uint nc)
   CPetBasicTerm::resize(nr, nc);
 
   setFixedSize(sizeHint());
+
+  update();
 }
 
 //---
@@ -91,23 +76,13 @@ readChar() const
 {
   auto *th = const_cast<CQPetBasicTerm *>(this);
 
-  if (! th->loopData_.eventLoop)
-    th->loopData_.eventLoop = new QEventLoop;
-
-  // wait for key to be pressed (with timeout)
-  th->loopData_.looping  = true;
-  th->loopData_.loopChar = true;
-  th->loopData_.loopC    = '\0';
+  th->flush();
 
-  loopData_.loopTimer->start(250);
+  // return buffered key (filled by GUI thread) or none
+  uchar c = '\0';
 
-  loopData_.eventLoop->exec();
-
-  loopData_.loopTimer->stop();
-
-  // loopC contains read char
-  auto c = loopData_.loopC;
-  if (! c) return '\0';
+  if (! basic()->popKey(c))
+    return '\0';
 
   // map to upper case
   c = std::toupper(c);
@@ -124,18 +99,44 @@ readString(const std::string &prompt) const
   // output prompt
   basic_->printString(prompt + "? ");
 
-  if (! th->loopData_.eventLoop)
-    th->loopData_.eventLoop = new QEventLoop;
+  th->flush();
+
+  // wait for string to be entered (no timeout), echoing keys as they arrive
+  th->loopData_.looping = true;
+
+  std::string str;
+
+  while (! basic()->isStopped()) {
+    uchar c;
+
+    if (! basic()->popKey(c)) {
+      // sleep until key pushed (or run stopped)
+      (void) basic()->waitKey(basic()->idleWait());
+      continue;
+    }
+
+    if (c == '\r')
+      break;
 
-  // wait for string to be entered (no timeout)
-  th->loopData_.looping  = true;
-  th->loopData_.loopChar = false;
-  th->loopData_.loopStr  = "";
+    if (c == 20) { // DEL
+      if (! str.empty()) {
+        str.pop_back();
 
-  loopData_.eventLoop->exec();
+        th->del();
+      }
+    }
+    else {
+      str += char(c);
 
-  // loopStr contains read string
-  auto str = th->loopData_.loopStr;
+      if (th->drawChar(c))
+        th->cursorRight();
+    }
+
+    th->update();
+    th->flush();
+  }
+
+  th->loopData_.looping = false;
 
   // map to upper case
   str = CPetBasicUtil::toUpper(str);
@@ -147,47 +148,31 @@ void
 CQPetBasicTerm::
 enterLoopStr(const std::string &str)
 {
-  loopData_.looping = false;
-
-  inputBuffer_ += str;
-
-  if (isLoopChar()) {
-    char c = '\0';
-
-    if (! inputBuffer_.empty()) {
-      c = inputBuffer_[0];
-
-      inputBuffer_ = inputBuffer_.substr(1);
-    }
-
-    loopData_.loopC    = c;
-    loopData_.loopChar = false;
-  }
-  else {
-    loopData_.loopStr = inputBuffer_;
-
-    inputBuffer_ = "";
-  }
+  basic()->pushKeys(str);
 
-  loopData_.eventLoop->exit(0);
+  basic()->pushKey('\r');
 }
 
 void
 CQPetBasicTerm::
 addLoopStr(const std::string &str)
 {
-  inputBuffer_ += str;
+  basic()->pushKeys(str);
 }
 
 void
 CQPetBasicTerm::
-loopTimeout()
+enterLine()
 {
-  if (isLooping()) {
-    loopData_.looping = false;
+  auto str = lineString();
 
-    loopData_.eventLoop->exit(0);
-  }
+  cursorDown();
+  cursorLeftFull();
+
+  update();
+
+  // direct mode commands are run on interpreter thread
+  basic()->postInputLine(str);
 }
 
 //---
@@ -289,35 +274,101 @@ drawString(const std::string &str)
 
 //---
 
-bool
+void
+CQPetBasicTerm::
+update()
+{
+  CPetBasicTerm::update();
+
+  // GUI thread edits are shown immediately (Qt coalesces repaints)
+  if (! basic()->isWorkerThread())
+    flush();
+}
+
+void
 CQPetBasicTerm::
-drawPoint(long x, long y, long c)
+redraw()
 {
-  if (image_)
-    image_->setPixel(x, y, qRgba(c, c, c, 255));
+  // interpreter thread sends snapshot to GUI
+  if (basic()->isWorkerThread()) {
+    basic()->postScreen(this);
+    return;
+  }
+
+  // GUI thread can only snapshot cells when interpreter is idle
+  if (basic()->isBusy())
+    return;
 
-  needsUpdate_ = true;
+  Screen screen;
 
-  return true;
-}
+  getScreen(screen);
 
-//---
+  setScreen(std::move(screen));
+}
 
 void
 CQPetBasicTerm::
-update()
+setScreen(Screen &&screen)
+{
+  // repaint only changed cells (all if size changed)
+  bool resized = (screen.nr != screen_.nr || screen.nc != screen_.nc);
+
+  auto dirty = screen.dirty;
+
+  screen_ = std::move(screen);
+
+  if      (resized)
+    QWidget::update();
+  else if (dirty.isSet())
+    QWidget::update(cellsRect(dirty));
+
+  //---
+
+  // upload changed framebuffer rows into plot image
+  if (image_ && ! screen_.pixels.empty()) {
+    int w = std::min(int(screen_.pw), image_->width());
+    int h = std::min(screen_.py2 + 1, image_->height());
+
+    for (int y = screen_.py1; y < h; ++y) {
+      const auto *src = &screen_.pixels[size_t(y - screen_.py1)*screen_.pw];
+
+      auto *dst = reinterpret_cast<QRgb *>(image_->scanLine(y));
+
+      for (int x = 0; x < w; ++x) {
+        auto g = src[x];
+
+        dst[x] = (g ? qRgba(g, g, g, 255) : 0);
+      }
+    }
+
+    if (screen_.py1 < h)
+      QWidget::update(QRect(0, screen_.py1, w, h - screen_.py1));
+
+    // pixels no longer needed
+    screen_.pixels.clear();
+  }
+}
+
+QRect
+CQPetBasicTerm::
+cellsRect(const DirtyRect &rect) const
 {
-  QWidget::update();
+  int x1 = int(std::floor(rect.c1*cw_));
+  int y1 = int(std::floor(rect.r1*ch_));
+  int x2 = int(std::ceil ((rect.c2 + 1)*cw_));
+  int y2 = int(std::ceil ((rect.r2 + 1)*ch_));
+
+  return QRect(x1, y1, x2 - x1, y2 - y1);
 }
 
 void
 CQPetBasicTerm::
 delay(long t)
 {
-  auto dieTime = QTime::currentTime().addMSecs(4*t);
+  flush();
 
-  while (QTime::currentTime() < dieTime)
-    qApp->processEvents(QEventLoop::AllEvents, 10);
+  // sleep for delay (woken early if run stopped)
+  (void) basic()->waitStopped(4*t*1000);
 }
 
 //---
@@ -328,16 +379,12 @@ cursorTimeout()
 {
   cursorBlink_ = ! cursorBlink_;
 
-  updateTimeout();
-}
+  // only cursor cell changes
+  DirtyRect rect;
 
-void
-CQPetBasicTerm::
-updateTimeout()
-{
-  update();
+  rect.add(screen_.r, screen_.c);
 
-  needsUpdate_ = false;
+  QWidget::update(cellsRect(rect));
 }
 
 //---
@@ -357,7 +404,15 @@ keyPressEvent(QKeyEvent *e)
   bool isShift = basic()->isShift();
   bool isCtrl  = (mod & Qt::ControlModifier);
 
+  // keys are read (and echoed) by interpreter thread while it is running
+  bool isBusy = basic()->isBusy();
+
   auto sendChar = [&](uchar c) {
+    if (isBusy) {
+      basic()->pushKey(c);
+      return;
+    }
+
     CPetDrawChar drawChar(c, 0, basic()->isReverse());
 
     if (isShift) {
@@ -368,18 +423,6 @@ keyPressEvent(QKeyEvent *e)
       drawChar = CPetBasic::petToDrawChar(pet);
     }
 
-    if (isLooping()) {
-      auto c1 = char(c);
-      auto s  = std::string(&c1, 1);
-
-      if (isLoopChar()) {
-        enterLoopStr(s);
-        return;
-      }
-
-      addLoopStr(s);
-    }
-
     setChar(row(), col(), drawChar);
     cursorRight();
     update();
@@ -429,18 +472,30 @@ keyPressEvent(QKeyEvent *e)
     case Qt::Key_Minus:        return sendChar('-');
     case Qt::Key_Equal:        return sendChar('=');
 
-    case Qt::Key_Backspace: { del(); update(); return; }
+    case Qt::Key_Backspace: {
+      if (isBusy)
+        basic()->pushKey(20);
+      else {
+        del(); update();
+      }
+      return;
+    }
 
     case Qt::Key_Return:
     case Qt::Key_Enter: {
-      if (isLooping())
-        enterLoopStr("");
-      else {
-        enterLine(); update();
-      }
+      if (isBusy)
+        basic()->pushKey('\r');
+      else
+        enterLine();
       return;
     }
+  }
 
+  // remaining keys edit screen so ignore while running
+  if (isBusy)
+    return;
+
+  switch (key) {
     case Qt::Key_Home: {
       if (! inQuotes()) {
         home();
@@ -480,11 +535,15 @@ resizeEvent(QResizeEvent *)
   image_ = new QImage(width(), height(), QImage::Format_ARGB32);
 
   image_->fill(QColor(0, 0, 0, 0).rgba());
+
+  // framebuffer is owned by interpreter thread while running
+  if (! basic()->isBusy())
+    frameBuffer_.resize(width(), height());
 }
 
 void
 CQPetBasicTerm::
-paintEvent(QPaintEvent *)
+paintEvent(QPaintEvent *e)
 {
   QFontMetricsF fm(font());
 
@@ -492,81 +551,215 @@ paintEvent(QPaintEvent *)
   ch_ = fm.height();
   ca_ = fm.ascent();
 
+  auto rect = e->rect();
+
   QPainter painter(this);
 
-  painter.fillRect(rect(), Qt::black);
+  painter.fillRect(rect, Qt::black);
 
   //---
 
   if (image_)
-    painter.drawImage(0, 0, *image_);
+    painter.drawImage(rect, *image_, rect);
 
   //---
 
-  double y = 0;
+  // paint from last screen snapshot (cells may be being updated by interpreter thread)
+  const auto &screen = screen_;
 
-  for (uint r = 0; r < nr_; ++r) {
-    double x = 0;
+  if (screen.nr == 0 || screen.nc == 0)
+    return;
 
-    for (uint c = 0; c < nc_; ++c) {
-      auto drawChar = getChar(r, c);
+  checkGlyphAtlas();
 
-      if (drawChar.isReverse()) {
-        painter.fillRect(QRect(x, y, cw_, ch_), Qt::white);
+  // only paint cells in exposed rect
+  int r1 = std::max(int(rect.top   ()/ch_), 0);
+  int r2 = std::min(int(rect.bottom()/ch_), int(screen.nr) - 1);
+  int c1 = std::max(int(rect.left  ()/cw_), 0);
+  int c2 = std::min(int(rect.right ()/cw_), int(screen.nc) - 1);
 
-        painter.setPen(Qt::black);
-      }
-      else {
-        painter.setPen(Qt::white);
-      }
+  for (int r = r1; r <= r2; ++r) {
+    double y = r*ch_;
+
+    for (int c = c1; c <= c2; ++c) {
+      double x = c*cw_;
+
+      const auto &drawChar = screen.getChar(r, c);
 
-      if (int(r) == r_ && int(c) == c_) {
-        if (cursorBlink_)
-          painter.fillRect(QRect(x, y, cw_, ch_), Qt::yellow);
+      // cursor is drawn directly (not cached)
+      if (cursorBlink_ && r == screen.r && c == screen.c) {
+        paintCell(&painter, x, y, drawChar, /*cursor*/true);
+        continue;
       }
 
-      // Valley
-      //  214 : Border
-      //  219 : Safe Castle
-      //   78 : Path up
-      //   77 : Path down
-      //  216 : Woods
-      //  173 : Swamps
-      //   87 : Tower
-      //   81 : Character
-
-      // Woods
-      //   96 : Border
-      //   88 : Trees
-      //  224 : Lake
-      //  230 : Vounims
-      //   81 : Character
-
-      // Swamps
-      //   96 : Border
-      //   45 : Tufts
-      //  224 : Lake
-      //  230 : Y Nagioth
-      //   81 : Character
-
-      // Tower
-      //  160 : Border
-      //  160 : Walls
-      //  102 : Stairs
-      //  104 : Doorway
-      //   42 : Treasures
-      //   81 : Character
-
-      if (drawChar.utf() > 0)
-        paintUtfChar(&painter, x, y, drawChar.utf());
-      else
-        paintChar(&painter, x, y, drawChar.c());
+      auto ind = glyphIndex(drawChar);
+
+      const auto &glyph = glyphAtlas_.glyphs[ind];
+
+      if (glyph.empty)
+        continue;
 
-      x += cw_;
+      painter.drawImage(QRectF(x, y, cw_, ch_), glyphAtlas_.image,
+                        QRectF(glyph.x, glyph.y, cw_, ch_));
     }
+  }
+}
+
+void
+CQPetBasicTerm::
+paintCell(QPainter *painter, double x, double y, const CPetDrawChar &drawChar,
+          bool cursor) const
+{
+  if (drawChar.isReverse()) {
+    painter->fillRect(QRectF(x, y, cw_, ch_), Qt::white);
 
-    y += ch_;
+    painter->setPen(Qt::black);
+  }
+  else {
+    painter->setPen(Qt::white);
   }
+
+  if (cursor)
+    painter->fillRect(QRectF(x, y, cw_, ch_), Qt::yellow);
+
+  // Valley
+  //  214 : Border
+  //  219 : Safe Castle
+  //   78 : Path up
+  //   77 : Path down
+  //  216 : Woods
+  //  173 : Swamps
+  //   87 : Tower
+  //   81 : Character
+
+  // Woods
+  //   96 : Border
+  //   88 : Trees
+  //  224 : Lake
+  //  230 : Vounims
+  //   81 : Character
+
+  // Swamps
+  //   96 : Border
+  //   45 : Tufts
+  //  224 : Lake
+  //  230 : Y Nagioth
+  //   81 : Character
+
+  // Tower
+  //  160 : Border
+  //  160 : Walls
+  //  102 : Stairs
+  //  104 : Doorway
+  //   42 : Treasures
+  //   81 : Character
+
+  if (drawChar.utf() > 0)
+    paintUtfChar(painter, x, y, drawChar.utf());
+  else
+    paintChar(painter, x, y, drawChar.c());
+}
+
+//---
+
+void
+CQPetBasicTerm::
+checkGlyphAtlas() const
+{
+  // glyph size depends on font so rebuild atlas if changed
+  int gw = int(std::ceil(cw_));
+  int gh = int(std::ceil(ch_));
+
+  if (glyphAtlas_.font == font() && glyphAtlas_.gw == gw && glyphAtlas_.gh == gh &&
+      ! glyphAtlas_.image.isNull())
+    return;
+
+  glyphAtlas_ = GlyphAtlas();
+
+  glyphAtlas_.font = font();
+  glyphAtlas_.gw   = gw;
+  glyphAtlas_.gh   = gh;
+
+  glyphAtlas_.image = QImage(GlyphAtlas::NUM_COLS*gw, 8*gh, QImage::Format_ARGB32_Premultiplied);
+  glyphAtlas_.image.fill(Qt::transparent);
+
+  // pre-render all PETSCII chars (normal and reverse)
+  for (int i = 0; i < 256; ++i) {
+    auto drawChar = CPetBasic::petToDrawChar(CPetsciChar(uchar(i)));
+
+    drawChar.setReverse(false);
+    (void) glyphIndex(drawChar);
+
+    drawChar.setReverse(true);
+    (void) glyphIndex(drawChar);
+  }
+}
+
+int
+CQPetBasicTerm::
+glyphIndex(const CPetDrawChar &drawChar) const
+{
+  auto pg = glyphAtlas_.index.find(drawChar.value());
+
+  if (pg != glyphAtlas_.index.end())
+    return (*pg).second;
+
+  //---
+
+  // add new glyph (grow atlas if full)
+  auto &atlas = glyphAtlas_;
+
+  int ind = int(atlas.glyphs.size());
+
+  int gx = (ind % GlyphAtlas::NUM_COLS)*atlas.gw;
+  int gy = (ind / GlyphAtlas::NUM_COLS)*atlas.gh;
+
+  if (gy + atlas.gh > atlas.image.height()) {
+    QImage image(atlas.image.width(), 2*atlas.image.height(), atlas.image.format());
+    image.fill(Qt::transparent);
+
+    QPainter painter(&image);
+    painter.setCompositionMode(QPainter::CompositionMode_Source);
+    painter.drawImage(0, 0, atlas.image);
+    painter.end();
+
+    atlas.image = image;
+  }
+
+  QPainter ipainter(&atlas.image);
+
+  ipainter.setFont(atlas.font);
+  ipainter.setClipRect(QRect(gx, gy, atlas.gw, atlas.gh));
+
+  paintCell(&ipainter, gx, gy, drawChar, /*cursor*/false);
+
+  ipainter.end();
+
+  // skip blit of blank glyphs (space)
+  bool empty = true;
+
+  for (int iy = 0; empty && iy < atlas.gh; ++iy) {
+    auto *line = reinterpret_cast<const QRgb *>(atlas.image.constScanLine(gy + iy));
+
+    for (int ix = 0; ix < atlas.gw; ++ix) {
+      if (qAlpha(line[gx + ix]) != 0) {
+        empty = false;
+        break;
+      }
+    }
+  }
+
+  GlyphAtlas::Glyph glyph;
+
+  glyph.x     = gx;
+  glyph.y     = gy;
+  glyph.empty = empty;
+
+  atlas.glyphs.push_back(glyph);
+
+  atlas.index[drawChar.value()] = ind;
+
+  return ind;
 }
 
 void
@@ -667,7 +860,10 @@ mousePressEvent(QMouseEvent *e)
   int r = e->y()/ch_;
   int c = e->x()/cw_;
 
-  auto drawChar = getChar(r, c);
+  if (r < 0 || r >= int(screen_.nr) || c < 0 || c >= int(screen_.nc))
+    return;
+
+  auto drawChar = screen_.getChar(r, c);
 
   auto petsci = CPetBasic::drawCharToPet(drawChar);
 
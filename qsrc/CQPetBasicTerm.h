@@ -4,12 +4,15 @@
 #include <CPetBasic.h>
 #include <CPetBasicTerm.h>
 #include <QWidget>
+#include <QImage>
+
+#include <atomic>
+#include <unordered_map>
 
 class CQPetBasicApp;
 class CQPetBasic;
 
 class QTimer;
-class QEventLoop;
 
 class CQPetBasicTerm : public QWidget, public CPetBasicTerm {
   Q_OBJECT
@@ -38,8 +41,8 @@ class CQPetBasicTerm : public QWidget, public CPetBasicTerm {
   //---
 
   bool isLooping() const { return loopData_.looping; }
-  bool isLoopChar() const { return loopData_.loopChar; }
 
+  // read char/string on interpreter thread (keys are posted by GUI thread)
   char readChar() const override;
 
   std::string readString(const std::string &prompt) const override;
@@ -47,15 +50,26 @@ class CQPetBasicTerm : public QWidget, public CPetBasicTerm {
   void enterLoopStr(const std::string &s);
   void addLoopStr(const std::string &s);
 
+  void enterLine() override;
+
   //---
 
   void inst() { }
 
   void update() override;
 
+  void redraw() override;
+
   void delay(long t) override;
 
-  bool drawPoint(long, long, long) override;
+  //---
+
+  // last screen snapshot (painted by GUI)
+  const Screen &screen() const { return screen_; }
+  void setScreen(Screen &&screen);
+
+  // widget rect of cells
+  QRect cellsRect(const DirtyRect &rect) const;
 
   //---
 
@@ -66,6 +80,9 @@ class CQPetBasicTerm : public QWidget, public CPetBasicTerm {
 
   void paintEvent(QPaintEvent *e) override;
 
+  void paintCell(QPainter *painter, double x, double y, const CPetDrawChar &drawChar,
+                 bool cursor) const;
+
   void paintChar(QPainter *painter, double x, double y, uchar c) const;
   void paintUtfChar(QPainter *painter, double x, double y, ulong utf) const;
 
@@ -73,11 +90,13 @@ class CQPetBasicTerm : public QWidget, public CPetBasicTerm {
 
   QSize sizeHint() const override;
 
+ private:
+  void checkGlyphAtlas() const;
+
+  int glyphIndex(const CPetDrawChar &drawChar) const;
+
  private Q_SLOTS:
   void cursorTimeout();
-  void updateTimeout();
-
-  void loopTimeout();
 
  private:
   CQPetBasicApp* app_ { nullptr };
@@ -85,26 +104,42 @@ class CQPetBasicTerm : public QWidget, public CPetBasicTerm {
   QTimer *cursorTimer_ { nullptr };
   bool    cursorBlink_ { false };
 
-  QTimer *updateTimer_ { nullptr };
-
   struct LoopData {
-    QTimer*     loopTimer { nullptr };
-    QEventLoop* eventLoop { nullptr };
-    bool        looping   { false };
-    bool        loopChar  { false };
-    std::string loopStr;
-    uchar       loopC     { 0 };
+    std::atomic<bool> looping { false }; // reading string
   };
 
   LoopData loopData_;
 
+  Screen screen_;
+
   mutable double cw_ { 8.0 };
   mutable double ch_ { 8.0 };
   mutable double ca_ { 8.0 };
 
   QImage *image_ { nullptr };
 
-  bool needsUpdate_ { false };
+  // pre-rendered cell glyphs (normal and reverse) blitted by paintEvent
+  struct GlyphAtlas {
+    static const int NUM_COLS = 64;
+
+    struct Glyph {
+      int  x     { 0 };
+      int  y     { 0 };
+      bool empty { false };
+    };
+
+    using Glyphs = std::vector<Glyph>;
+    using Index  = std::unordered_map<uint, int>;
+
+    QFont  font;
+    int    gw { 0 };
+    int    gh { 0 };
+    QImage image;
+    Glyphs glyphs;
+    Index  index; // draw char value to glyph index
+  };
+
+  mutable GlyphAtlas glyphAtlas_;
 };
 
 #endif
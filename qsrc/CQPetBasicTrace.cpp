@@ -0,0 +1,391 @@
+#include <CQPetBasicTrace.h>
+#include <CQPetBasicApp.h>
+#include <CQPetBasic.h>
+
+#include <CQUtil.h>
+
+#include <QCheckBox>
+#include <QFileDialog>
+#include <QLabel>
+#include <QMouseEvent>
+#include <QPainter>
+#include <QPushButton>
+#include <QToolTip>
+#include <QVBoxLayout>
+#include <QWheelEvent>
+
+#include <algorithm>
+
+CQPetBasicTrace::
+CQPetBasicTrace(CQPetBasicApp *app) :
+ app_(app)
+{
+  setObjectName("trace");
+
+  auto *layout = CQUtil::makeLayout<QVBoxLayout>(this, 2, 2);
+
+  view_ = new CQPetBasicTraceView(this);
+
+  layout->addWidget(view_);
+
+  auto *toolbarFrame  = CQUtil::makeWidget<QFrame>(this, "toolbar");
+  auto *toolbarLayout = CQUtil::makeLayout<QHBoxLayout>(toolbarFrame, 2, 2);
+
+  toolbarFrame->setSizePolicy(QSizePolicy::Expanding, QSizePolicy::Fixed);
+
+  recordCheck_ = CQUtil::makeLabelWidget<QCheckBox>("Record", "record");
+
+  recordCheck_->setToolTip("Record trace of runs to " + recordFile_);
+
+  connect(recordCheck_, SIGNAL(stateChanged(int)), this, SLOT(recordSlot(int)));
+
+  auto *loadButton   = CQUtil::makeLabelWidget<QPushButton>("Load"  , "load");
+  auto *replayButton = CQUtil::makeLabelWidget<QPushButton>("Replay", "replay");
+
+  loadButton  ->setToolTip("Load trace file");
+  replayButton->setToolTip("Run program with input and RND results from loaded trace");
+
+  connect(loadButton  , SIGNAL(clicked()), this, SLOT(loadSlot()));
+  connect(replayButton, SIGNAL(clicked()), this, SLOT(replaySlot()));
+
+  infoLabel_ = CQUtil::makeLabelWidget<QLabel>("", "info");
+
+  toolbarLayout->addWidget(recordCheck_);
+  toolbarLayout->addWidget(loadButton);
+  toolbarLayout->addWidget(replayButton);
+  toolbarLayout->addWidget(infoLabel_);
+  toolbarLayout->addStretch();
+
+  layout->addWidget(toolbarFrame);
+}
+
+void
+CQPetBasicTrace::
+recordSlot(int state)
+{
+  auto *basic = app_->basic();
+
+  // trace belongs to the worker while it is running
+  if (basic->isBusy())
+    return;
+
+  if (state == Qt::Checked) {
+    if (! basic->startTraceRecord(recordFile_.toStdString())) {
+      app_->errorMsg("Failed to record trace to " + recordFile_);
+      return;
+    }
+
+    fileName_ = recordFile_;
+  }
+  else {
+    basic->stopTrace();
+
+    loadFile(recordFile_);
+  }
+}
+
+void
+CQPetBasicTrace::
+loadSlot()
+{
+  auto fileName = QFileDialog::getOpenFileName(this, "Load Trace", "", "Trace (*.trace);;All (*)");
+
+  if (fileName == "")
+    return;
+
+  loadFile(fileName);
+}
+
+void
+CQPetBasicTrace::
+replaySlot()
+{
+  auto *basic = app_->basic();
+
+  if (basic->isBusy() || fileName_ == "")
+    return;
+
+  recordCheck_->setChecked(false);
+
+  if (! basic->startTraceReplay(fileName_.toStdString())) {
+    app_->errorMsg("Failed to replay trace " + fileName_);
+    return;
+  }
+
+  basic->postRun();
+}
+
+void
+CQPetBasicTrace::
+updateTrace()
+{
+  auto *basic = app_->basic();
+
+  if (basic->isBusy())
+    return;
+
+  // replay is for one run
+  if (basic->isTraceReplay()) {
+    basic->stopTrace();
+    return;
+  }
+
+  // only recording trace changes (file is mapped by worker so read when idle)
+  if (! basic->isTraceRecord())
+    return;
+
+  if (! isVisible())
+    needsReload_ = true;
+  else
+    loadFile(recordFile_);
+}
+
+void
+CQPetBasicTrace::
+showEvent(QShowEvent *)
+{
+  if (needsReload_) {
+    needsReload_ = false;
+
+    loadFile(recordFile_);
+  }
+}
+
+void
+CQPetBasicTrace::
+loadFile(const QString &fileName)
+{
+  fileName_ = fileName;
+
+  if (! view_->load(fileName))
+    app_->errorMsg("Failed to load trace " + fileName);
+
+  updateInfo();
+}
+
+void
+CQPetBasicTrace::
+updateInfo()
+{
+  infoLabel_->setText(QString("%1 : %2 statements").
+    arg(fileName_).arg(view_->numStatements()));
+}
+
+//---
+
+CQPetBasicTraceView::
+CQPetBasicTraceView(CQPetBasicTrace *trace) :
+ trace_(trace)
+{
+  setObjectName("view");
+
+  setMouseTracking(true);
+
+  setSizePolicy(QSizePolicy::Expanding, QSizePolicy::Expanding);
+}
+
+bool
+CQPetBasicTraceView::
+load(const QString &fileName)
+{
+  using RecordType = CPetBasicTrace::RecordType;
+
+  statements_.clear();
+  events_    .clear();
+
+  maxStatement_ = 0;
+
+  CPetBasicTrace trace;
+
+  bool rc = trace.load(fileName.toStdString());
+
+  // flatten records to statement sequence with events at statement positions
+  if (rc) {
+    for (auto i = trace.firstInd(); i < trace.count(); ++i) {
+      const auto &record = trace.record(i);
+
+      switch (record.type) {
+        case RecordType::START:
+          maxStatement_ = std::max(maxStatement_, record.value);
+          break;
+        case RecordType::STATEMENT:
+          statements_.push_back(record.value);
+
+          maxStatement_ = std::max(maxStatement_, record.value + 1);
+          break;
+        case RecordType::GET:
+          if (record.value)
+            events_.push_back(Event{statements_.size(), EventType::INPUT});
+          break;
+        case RecordType::INPUT_END:
+          events_.push_back(Event{statements_.size(), EventType::INPUT});
+          break;
+        case RecordType::RND:
+          if (record.aux == 0)
+            events_.push_back(Event{statements_.size(), EventType::RND});
+          break;
+        default:
+          break;
+      }
+    }
+  }
+
+  resetZoom();
+
+  return rc;
+}
+
+void
+CQPetBasicTraceView::
+resetZoom()
+{
+  start_ = 0;
+  end_   = statements_.size();
+
+  update();
+}
+
+size_t
+CQPetBasicTraceView::
+xToPos(int x) const
+{
+  auto w = std::max(width(), 1);
+
+  return start_ + size_t(double(std::max(x, 0))*double(end_ - start_)/w);
+}
+
+int
+CQPetBasicTraceView::
+posToX(size_t pos) const
+{
+  if (end_ <= start_)
+    return 0;
+
+  return int(double(pos - start_)*width()/double(end_ - start_));
+}
+
+void
+CQPetBasicTraceView::
+paintEvent(QPaintEvent *)
+{
+  QPainter painter(this);
+
+  painter.fillRect(rect(), Qt::white);
+
+  if (statements_.empty() || end_ <= start_ || maxStatement_ == 0)
+    return;
+
+  int eh = 8; // event strip height
+  int w  = width();
+  int h  = height() - eh;
+
+  auto yPos = [&](uint ind) { return eh + int(double(ind)*(h - 1)/double(maxStatement_)); };
+
+  //---
+
+  // statement range per pixel column
+  painter.setPen(lineColor_);
+
+  for (int x = 0; x < w; ++x) {
+    auto pos1 = xToPos(x);
+    auto pos2 = std::max(xToPos(x + 1), pos1 + 1);
+
+    pos2 = std::min(pos2, end_);
+
+    if (pos1 >= pos2)
+      continue;
+
+    auto pm = std::minmax_element(statements_.begin() + long(pos1), statements_.begin() + long(pos2));
+
+    painter.drawLine(x, yPos(*pm.first), x, yPos(*pm.second));
+  }
+
+  //---
+
+  // input and RND events
+  auto pe = std::lower_bound(events_.begin(), events_.end(), start_,
+              [](const Event &event, size_t pos) { return event.pos < pos; });
+
+  for ( ; pe != events_.end() && (*pe).pos < end_; ++pe) {
+    const auto &event = *pe;
+
+    int x = posToX(event.pos);
+
+    if (event.type == EventType::INPUT)
+      painter.setPen(inputColor_);
+    else
+      painter.setPen(rndColor_);
+
+    painter.drawLine(x, 0, x, eh - 2);
+  }
+}
+
+void
+CQPetBasicTraceView::
+mouseMoveEvent(QMouseEvent *e)
+{
+  auto pos = xToPos(e->x());
+
+  if (pos >= end_ || pos >= statements_.size())
+    return;
+
+  auto ind = statements_[pos];
+
+  auto *basic = trace_->app()->basic();
+
+  // line map belongs to the worker while it is running
+  uint lineNum = 0, statementNum = 0;
+
+  QString text;
+
+  if (! basic->isBusy() && basic->statementLine(ind, lineNum, statementNum))
+    text = QString("%1 : Line %2:%3").arg(pos).arg(lineNum).arg(statementNum + 1);
+  else
+    text = QString("%1 : Statement %2").arg(pos).arg(ind);
+
+  QToolTip::showText(e->globalPos(), text, this);
+}
+
+void
+CQPetBasicTraceView::
+mouseDoubleClickEvent(QMouseEvent *)
+{
+  resetZoom();
+}
+
+void
+CQPetBasicTraceView::
+wheelEvent(QWheelEvent *e)
+{
+  if (end_ <= start_)
+    return;
+
+  // zoom in/out around position under mouse
+  auto pos   = xToPos(int(e->position().x()));
+  auto range = double(end_ - start_);
+
+  range *= (e->angleDelta().y() > 0 ? 0.5 : 2.0);
+
+  auto range1 = size_t(std::max(range, double(std::min(width(), 16))));
+
+  range1 = std::min(range1, statements_.size());
+
+  auto f = double(pos - start_)/double(end_ - start_);
+
+  auto start = long(pos) - long(f*range1);
+
+  start = std::max(start, 0L);
+  start = std::min(start, long(statements_.size() - range1));
+
+  start_ = size_t(start);
+  end_   = start_ + range1;
+
+  update();
+}
+
+QSize
+CQPetBasicTraceView::
+sizeHint() const
+{
+  return QSize(400, 200);
+}
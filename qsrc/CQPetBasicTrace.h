@@ -0,0 +1,102 @@
+#ifndef CQPetBasicTrace_H
+#define CQPetBasicTrace_H
+
+#include <CPetBasicTrace.h>
+#include <QFrame>
+
+class CQPetBasicApp;
+class CQPetBasicTraceView;
+
+class QCheckBox;
+class QLabel;
+
+// execution trace tab : record/load/replay trace and show it as a timeline
+class CQPetBasicTrace : public QFrame {
+  Q_OBJECT
+
+ public:
+  CQPetBasicTrace(CQPetBasicApp *app);
+
+  CQPetBasicApp *app() const { return app_; }
+
+  // reload recorded trace (run stopped)
+  void updateTrace();
+
+  void showEvent(QShowEvent *) override;
+
+ private Q_SLOTS:
+  void recordSlot(int state);
+  void loadSlot();
+  void replaySlot();
+
+ private:
+  void loadFile(const QString &fileName);
+
+  void updateInfo();
+
+ private:
+  CQPetBasicApp*       app_         { nullptr };
+  CQPetBasicTraceView* view_        { nullptr };
+  QCheckBox*           recordCheck_ { nullptr };
+  QLabel*              infoLabel_   { nullptr };
+  QString              recordFile_  { "CQPetBasic.trace" };
+  QString              fileName_;
+  bool                 needsReload_ { false };
+};
+
+//---
+
+// timeline of trace : x is statement sequence (zoomable), y is statement position
+// in program (min/max range of statements run per pixel column) with input and RND
+// events marked along top
+class CQPetBasicTraceView : public QFrame {
+  Q_OBJECT
+
+ public:
+  CQPetBasicTraceView(CQPetBasicTrace *trace);
+
+  bool load(const QString &fileName);
+
+  size_t numStatements() const { return statements_.size(); }
+
+  void resetZoom();
+
+  void paintEvent(QPaintEvent *) override;
+
+  void mouseMoveEvent(QMouseEvent *e) override;
+  void mouseDoubleClickEvent(QMouseEvent *e) override;
+
+  void wheelEvent(QWheelEvent *e) override;
+
+  QSize sizeHint() const override;
+
+ private:
+  enum class EventType {
+    INPUT,
+    RND
+  };
+
+  struct Event {
+    size_t    pos  { 0 }; // statement sequence number
+    EventType type { EventType::INPUT };
+  };
+
+  using Statements = std::vector<uint>;
+  using Events     = std::vector<Event>;
+
+  size_t xToPos(int x) const;
+  int    posToX(size_t pos) const;
+
+ private:
+  CQPetBasicTrace* trace_         { nullptr };
+  Statements       statements_;                // flattened statement index per step
+  Events           events_;
+  uint             maxStatement_  { 0 };
+  size_t           start_         { 0 };       // visible statement range
+  size_t           end_           { 0 };
+  QColor           lineColor_     { 56, 88, 158 };
+  QColor           inputColor_    { 60, 160, 60 };
+  QColor           rndColor_      { 200, 120, 0 };
+};
+
+#endif
@@ -3,9 +3,10 @@
 #include <CQPetBasic.h>
 #include <CExpr.h>
 
-#include <CQDataModel.h>
 #include <CQUtil.h>
 
+#include <algorithm>
+
 CQPetBasicVariables::
 CQPetBasicVariables(CQPetBasicApp *app) :
  app_(app)
@@ -29,11 +30,42 @@ reload()
     view_->updateModel();
 }
 
+void
+CQPetBasicVariables::
+applyChanges(const CPetBasic::VariableChanges &changes)
+{
+  // hidden view is rebuilt when shown (or when idle if shown while busy)
+  if      (! isVisible())
+    needsReload_ = true;
+  else if (needsReload_) {
+    needsReload_ = false;
+
+    view_->updateModel();
+  }
+  else
+    view_->applyChanges(changes);
+}
+
+void
+CQPetBasicVariables::
+applyValues(const CQPetBasic::VariableValues &values)
+{
+  // a reset has all names and values so can also rebuild a view needing reload
+  if (! isVisible())
+    needsReload_ = true;
+  else if (! needsReload_ || values.reset) {
+    needsReload_ = false;
+
+    view_->applyValues(values);
+  }
+}
+
 void
 CQPetBasicVariables::
 showEvent(QShowEvent *)
 {
-  if (needsReload_) {
+  // variables can only be read when idle
+  if (needsReload_ && ! app_->basic()->isBusy()) {
     needsReload_ = false;
 
     view_->updateModel();
@@ -57,9 +89,7 @@ CQPetBasicVariablesList(CQPetBasicVariables *variables) :
 {
   setObjectName("list");
 
-  model_ = new CQDataModel;
-
-  updateModel();
+  model_ = new CQPetBasicVariablesModel(variables_);
 
   setModel(model_);
 }
@@ -68,53 +98,537 @@ void
 CQPetBasicVariablesList::
 updateModel()
 {
-  auto *basic = variables_->app()->basic();
+  model_->reload();
+}
 
+void
+CQPetBasicVariablesList::
+applyChanges(const CPetBasic::VariableChanges &changes)
+{
+  model_->applyChanges(changes);
+}
+
+void
+CQPetBasicVariablesList::
+applyValues(const CQPetBasic::VariableValues &values)
+{
+  model_->applyValues(values);
+}
+
+//---
+
+CQPetBasicVariablesModel::
+CQPetBasicVariablesModel(CQPetBasicVariables *variables) :
+ variables_(variables)
+{
+  setObjectName("model");
+}
+
+CQPetBasic *
+CQPetBasicVariablesModel::
+basic() const
+{
+  return variables_->app()->basic();
+}
+
+void
+CQPetBasicVariablesModel::
+reload()
+{
   std::vector<std::string> names, arrayNames;
 
-  basic->getVariableNames(names, arrayNames);
+  basic()->getVariableNames(names, arrayNames);
 
-  auto nr1 = names.size();
-  auto nr2 = arrayNames.size();
+  resetVariables(names, arrayNames);
+}
 
-  model_->resizeModel(2, nr1 + nr2);
+void
+CQPetBasicVariablesModel::
+resetVariables(const std::vector<std::string> &names,
+               const std::vector<std::string> &arrayNames)
+{
+  beginResetModel();
 
-  model_->setHeaderData(0, Qt::Horizontal, "Name");
-  model_->setHeaderData(1, Qt::Horizontal, "Value");
+  varDatas_.clear();
 
-  uint r = 0;
+  for (const auto &name : names)
+    varDatas_.push_back(makeVarData(name, /*isArray*/false));
 
-  for (uint r1 = 0; r1 < nr1; ++r1, ++r) {
-    auto ind0 = model_->index(r, 0, QModelIndex());
-    model_->setData(ind0, QString::fromStdString(names[r1]));
+  for (const auto &name : arrayNames)
+    varDatas_.push_back(makeVarData(name, /*isArray*/true));
 
-    auto value = basic->getVariableValue(names[r1]);
+  updateNameRows();
 
-    QVariant vvalue;
+  endResetModel();
+}
 
-    std::string s;
-    if (value && value->getStringValue(s))
-      vvalue = QString::fromStdString(s);
+void
+CQPetBasicVariablesModel::
+applyChanges(const CPetBasic::VariableChanges &changes)
+{
+  if (changes.reset) {
+    reload();
+    return;
+  }
 
-    auto ind1 = model_->index(r, 1, QModelIndex());
-    model_->setData(ind1, vvalue);
+  for (const auto &name : changes.names) {
+    auto pn = nameRows_.find(name);
+
+    if (pn == nameRows_.end())
+      insertVariable(name, /*isArray*/false);
+    else
+      updateVariable((*pn).second);
   }
 
-  for (uint r2 = 0; r2 < nr2; ++r2, ++r) {
-    auto ind0 = model_->index(r, 0, QModelIndex());
-    model_->setData(ind0, QString::fromStdString(arrayNames[r2]));
+  for (const auto &name : changes.arrayNames) {
+    auto pn = arrayNameRows_.find(name);
+
+    if (pn == arrayNameRows_.end())
+      insertVariable(name, /*isArray*/true);
+    else
+      updateVariable((*pn).second);
+  }
+}
+
+void
+CQPetBasicVariablesModel::
+applyValues(const CQPetBasic::VariableValues &values)
+{
+  if (values.reset)
+    resetVariables(values.names, values.arrayNames);
 
-    QVariant vvalue;
+  for (const auto &pv : values.values) {
+    int row = variableRow(pv.first, /*isArray*/false);
 
-    CPetBasic::Inds inds; inds.push_back(0);
+    auto &varData = varDatas_[size_t(row)];
 
-    auto value = basic->getVariableValue(arrayNames[r2], inds);
+    varData.value.str   = QString::fromStdString(pv.second);
+    varData.value.valid = true;
+
+    auto ind = index(row, 1, QModelIndex());
+
+    Q_EMIT dataChanged(ind, ind);
+  }
+
+  for (const auto &pa : values.arrayValues) {
+    int row = variableRow(pa.first, /*isArray*/true);
+
+    auto &varData = varDatas_[size_t(row)];
+
+    const auto &arrayValues = pa.second;
+
+    auto numValues = varData.numValues;
+
+    setArrayDims(varData, arrayValues.dims);
+
+    updateArrayRows(row, numValues);
+
+    // set fetched elements in worker's values (others keep cached value until idle)
+    auto n = std::min(varData.numFetched, uint(arrayValues.values.size()));
+
+    for (uint i = 0; i < n; ++i) {
+      auto &value = varData.values[i];
+
+      value.str   = QString::fromStdString(arrayValues.values[i]);
+      value.valid = true;
+    }
+  }
+}
+
+CQPetBasicVariablesModel::VarData
+CQPetBasicVariablesModel::
+makeVarData(const std::string &name, bool isArray) const
+{
+  VarData varData;
+
+  varData.name    = name;
+  varData.isArray = isArray;
+
+  // dims are set from worker values while busy
+  if (isArray && ! basic()->isBusy())
+    updateArrayDims(varData);
+
+  return varData;
+}
+
+void
+CQPetBasicVariablesModel::
+updateArrayDims(VarData &varData) const
+{
+  CPetBasic::Inds dims;
+
+  basic()->getArrayDims(varData.name, dims);
+
+  setArrayDims(varData, dims);
+}
+
+void
+CQPetBasicVariablesModel::
+setArrayDims(VarData &varData, const CPetBasic::Inds &dims) const
+{
+  varData.dims = dims;
+
+  uint n = (varData.dims.empty() ? 0 : 1);
+
+  for (const auto &dim : varData.dims)
+    n *= dim;
+
+  varData.numValues = n;
+}
+
+void
+CQPetBasicVariablesModel::
+updateNameRows()
+{
+  nameRows_     .clear();
+  arrayNameRows_.clear();
+
+  numNames_ = 0;
+
+  int row = 0;
+
+  for (const auto &varData : varDatas_) {
+    if (varData.isArray)
+      arrayNameRows_[varData.name] = row;
+    else {
+      nameRows_[varData.name] = row;
+
+      ++numNames_;
+    }
+
+    ++row;
+  }
+}
+
+int
+CQPetBasicVariablesModel::
+variableRow(const std::string &name, bool isArray)
+{
+  const auto &nameRows = (isArray ? arrayNameRows_ : nameRows_);
+
+  auto pn = nameRows.find(name);
+
+  if (pn != nameRows.end())
+    return (*pn).second;
+
+  return insertVariable(name, isArray);
+}
+
+int
+CQPetBasicVariablesModel::
+insertVariable(const std::string &name, bool isArray)
+{
+  // keep names sorted within scalar and array sections
+  int row1 = (isArray ? numNames_ : 0);
+  int row2 = (isArray ? int(varDatas_.size()) : numNames_);
+
+  int row = row1;
+
+  while (row < row2 && varDatas_[size_t(row)].name < name)
+    ++row;
+
+  beginInsertRows(QModelIndex(), row, row);
+
+  varDatas_.insert(varDatas_.begin() + row, makeVarData(name, isArray));
+
+  updateNameRows();
+
+  endInsertRows();
+
+  return row;
+}
+
+void
+CQPetBasicVariablesModel::
+updateVariable(int row)
+{
+  auto &varData = varDatas_[size_t(row)];
+
+  varData.value.valid = false;
+
+  if (varData.isArray) {
+    auto numValues = varData.numValues;
+
+    updateArrayDims(varData);
+
+    updateArrayRows(row, numValues);
+  }
+  else {
+    auto ind = index(row, 1, QModelIndex());
+
+    Q_EMIT dataChanged(ind, ind);
+  }
+}
+
+void
+CQPetBasicVariablesModel::
+updateArrayRows(int row, uint numValues)
+{
+  auto &varData = varDatas_[size_t(row)];
+
+  // dims string
+  varData.value.valid = false;
+
+  auto parent = index(row, 0, QModelIndex());
+
+  if      (varData.numValues != numValues) {
+    // redimensioned so drop fetched elements
+    if (varData.numFetched > 0) {
+      beginRemoveRows(parent, 0, int(varData.numFetched) - 1);
+
+      varData.numFetched = 0;
+
+      varData.values.clear();
+
+      endRemoveRows();
+    }
+  }
+  else if (varData.numFetched > 0) {
+    for (auto &value : varData.values)
+      value.valid = false;
+
+    Q_EMIT dataChanged(index(0, 1, parent), index(int(varData.numFetched) - 1, 1, parent));
+  }
+
+  auto ind = index(row, 1, QModelIndex());
+
+  Q_EMIT dataChanged(ind, ind);
+}
+
+//---
+
+QModelIndex
+CQPetBasicVariablesModel::
+index(int row, int column, const QModelIndex &parent) const
+{
+  if (row < 0 || column < 0 || column >= 2)
+    return QModelIndex();
+
+  // internal id is zero for variable rows and parent row + 1 for array elements
+  if (! parent.isValid()) {
+    if (row >= int(varDatas_.size()))
+      return QModelIndex();
+
+    return createIndex(row, column, quintptr(0));
+  }
+
+  if (parent.internalId() != 0 || parent.row() >= int(varDatas_.size()))
+    return QModelIndex();
+
+  const auto &varData = varDatas_[size_t(parent.row())];
+
+  if (row >= int(varData.numFetched))
+    return QModelIndex();
+
+  return createIndex(row, column, quintptr(parent.row() + 1));
+}
+
+QModelIndex
+CQPetBasicVariablesModel::
+parent(const QModelIndex &index) const
+{
+  if (! index.isValid() || index.internalId() == 0)
+    return QModelIndex();
+
+  return createIndex(int(index.internalId() - 1), 0, quintptr(0));
+}
+
+int
+CQPetBasicVariablesModel::
+rowCount(const QModelIndex &parent) const
+{
+  if (! parent.isValid())
+    return int(varDatas_.size());
+
+  if (parent.internalId() != 0 || parent.column() != 0)
+    return 0;
+
+  return int(varDatas_[size_t(parent.row())].numFetched);
+}
+
+int
+CQPetBasicVariablesModel::
+columnCount(const QModelIndex &) const
+{
+  return 2;
+}
+
+bool
+CQPetBasicVariablesModel::
+hasChildren(const QModelIndex &parent) const
+{
+  if (! parent.isValid())
+    return ! varDatas_.empty();
+
+  if (parent.internalId() != 0 || parent.column() != 0)
+    return false;
+
+  return (varDatas_[size_t(parent.row())].numValues > 0);
+}
+
+bool
+CQPetBasicVariablesModel::
+canFetchMore(const QModelIndex &parent) const
+{
+  if (! parent.isValid() || parent.internalId() != 0)
+    return false;
+
+  const auto &varData = varDatas_[size_t(parent.row())];
+
+  return (varData.numFetched < varData.numValues);
+}
+
+void
+CQPetBasicVariablesModel::
+fetchMore(const QModelIndex &parent)
+{
+  static const uint fetchSize = 256;
+
+  if (! canFetchMore(parent))
+    return;
+
+  auto &varData = varDatas_[size_t(parent.row())];
+
+  auto n = std::min(fetchSize, varData.numValues - varData.numFetched);
+
+  beginInsertRows(parent, int(varData.numFetched), int(varData.numFetched + n) - 1);
+
+  varData.numFetched += n;
+
+  varData.values.resize(varData.numFetched);
+
+  endInsertRows();
+}
+
+QVariant
+CQPetBasicVariablesModel::
+data(const QModelIndex &index, int role) const
+{
+  if (! index.isValid() || role != Qt::DisplayRole)
+    return QVariant();
+
+  if (index.internalId() == 0) {
+    const auto &varData = varDatas_[size_t(index.row())];
+
+    if (index.column() == 0)
+      return QString::fromStdString(varData.name);
+
+    return varValue(varData).str;
+  }
+  else {
+    const auto &varData = varDatas_[size_t(index.internalId() - 1)];
+
+    auto i = uint(index.row());
+
+    if (index.column() == 0)
+      return elementName(varData, i);
+
+    return elementValue(varData, i).str;
+  }
+}
+
+QVariant
+CQPetBasicVariablesModel::
+headerData(int section, Qt::Orientation orientation, int role) const
+{
+  if (orientation != Qt::Horizontal || role != Qt::DisplayRole)
+    return QVariant();
+
+  if      (section == 0) return QString("Name");
+  else if (section == 1) return QString("Value");
+
+  return QVariant();
+}
+
+//---
+
+const CQPetBasicVariablesModel::Value &
+CQPetBasicVariablesModel::
+varValue(const VarData &varData) const
+{
+  const auto &value = varData.value;
+
+  if (value.valid)
+    return value;
+
+  if (varData.isArray) {
+    QString str;
+
+    for (const auto &dim : varData.dims) {
+      if (str.length())
+        str += ",";
+
+      str += QString::number(dim - 1);
+    }
+
+    value.str = "(" + str + ")";
+  }
+  else {
+    // interpreter state can only be read when idle
+    if (basic()->isBusy())
+      return value;
+
+    auto val = basic()->getVariableValue(varData.name);
 
     std::string s;
-    if (value && value->getStringValue(s))
-      vvalue = QString::fromStdString(s);
+    if (val && val->getStringValue(s))
+      value.str = QString::fromStdString(s);
+    else
+      value.str = QString();
+  }
+
+  value.valid = true;
+
+  return value;
+}
+
+const CQPetBasicVariablesModel::Value &
+CQPetBasicVariablesModel::
+elementValue(const VarData &varData, uint i) const
+{
+  const auto &value = varData.values[i];
+
+  if (value.valid || basic()->isBusy())
+    return value;
+
+  auto val = basic()->getArrayValue(varData.name, i);
 
-    auto ind1 = model_->index(r, 1, QModelIndex());
-    model_->setData(ind1, vvalue);
+  std::string s;
+  if (val && val->getStringValue(s))
+    value.str = QString::fromStdString(s);
+  else
+    value.str = QString();
+
+  value.valid = true;
+
+  return value;
+}
+
+QString
+CQPetBasicVariablesModel::
+elementName(const VarData &varData, uint i) const
+{
+  // flat index to indices (last index fastest)
+  auto n = varData.dims.size();
+
+  std::vector<uint> inds(n);
+
+  for (size_t j = n; j > 0; --j) {
+    auto dim = std::max(varData.dims[j - 1], 1U);
+
+    inds[j - 1] = i % dim;
+
+    i /= dim;
   }
+
+  QString str;
+
+  for (const auto &ind : inds) {
+    if (str.length())
+      str += ",";
+
+    str += QString::number(ind);
+  }
+
+  return QString::fromStdString(varData.name) + "(" + str + ")";
 }
@@ -1,13 +1,15 @@
 #ifndef CQPetBasicVariables_H
 #define CQPetBasicVariables_H
 
+#include <CQPetBasic.h>
 #include <CQModelView.h>
+#include <QAbstractItemModel>
 #include <QFrame>
 
 class CQPetBasicApp;
 class CQPetBasicVariablesList;
+class CQPetBasicVariablesModel;
 class CQModelView;
-class CQDataModel;
 
 class CQPetBasicVariables : public QFrame {
   Q_OBJECT
@@ -19,6 +21,10 @@ class CQPetBasicVariables : public QFrame {
 
   void reload();
 
+  void applyChanges(const CPetBasic::VariableChanges &changes);
+
+  void applyValues(const CQPetBasic::VariableValues &values);
+
   void showEvent(QShowEvent *) override;
 
   QSize sizeHint() const override;
@@ -26,10 +32,11 @@ class CQPetBasicVariables : public QFrame {
  private:
   CQPetBasicApp*           app_         { nullptr };
   CQPetBasicVariablesList* view_        { nullptr };
-  CQDataModel*             model_       { nullptr };
   bool                     needsReload_ { true };
 };
 
+//---
+
 class CQPetBasicVariablesList : public CQModelView {
   Q_OBJECT
 
@@ -38,9 +45,110 @@ class CQPetBasicVariablesList : public CQModelView {
 
   void updateModel();
 
+  void applyChanges(const CPetBasic::VariableChanges &changes);
+
+  void applyValues(const CQPetBasic::VariableValues &values);
+
+ private:
+  CQPetBasicVariables*      variables_ { nullptr };
+  CQPetBasicVariablesModel* model_     { nullptr };
+};
+
+//---
+
+// Model of scalar variables followed by array variables.
+//
+// Values are formatted on demand (only for visible rows) and cached until the
+// variable changes. Array elements are children of the array row and are added
+// in chunks as the view asks for them (fetchMore). While the interpreter is busy its
+// state is owned by the worker thread so changed rows are set from values formatted
+// by the worker (applyValues) and other rows use their cached values.
+class CQPetBasicVariablesModel : public QAbstractItemModel {
+  Q_OBJECT
+
+ public:
+  CQPetBasicVariablesModel(CQPetBasicVariables *variables);
+
+  // rebuild all rows
+  void reload();
+
+  // update rows for changed variables (when idle)
+  void applyChanges(const CPetBasic::VariableChanges &changes);
+
+  // update rows for changed variables from worker values (while busy)
+  void applyValues(const CQPetBasic::VariableValues &values);
+
+  //---
+
+  QModelIndex index(int row, int column, const QModelIndex &parent) const override;
+  QModelIndex parent(const QModelIndex &index) const override;
+
+  int rowCount   (const QModelIndex &parent) const override;
+  int columnCount(const QModelIndex &parent) const override;
+
+  bool hasChildren(const QModelIndex &parent) const override;
+
+  bool canFetchMore(const QModelIndex &parent) const override;
+  void fetchMore(const QModelIndex &parent) override;
+
+  QVariant data(const QModelIndex &index, int role) const override;
+
+  QVariant headerData(int section, Qt::Orientation orientation, int role) const override;
+
+ private:
+  // cached formatted value
+  struct Value {
+    mutable QString str;
+    mutable bool    valid { false };
+  };
+
+  using Values = std::vector<Value>;
+
+  struct VarData {
+    std::string     name;
+    bool            isArray    { false };
+    CPetBasic::Inds dims;
+    uint            numValues  { 0 };
+    uint            numFetched { 0 };
+    Value           value;
+    Values          values;
+  };
+
+  using VarDatas = std::vector<VarData>;
+  using NameRow  = std::map<std::string, int>;
+
+ private:
+  CQPetBasic *basic() const;
+
+  void resetVariables(const std::vector<std::string> &names,
+                      const std::vector<std::string> &arrayNames);
+
+  VarData makeVarData(const std::string &name, bool isArray) const;
+
+  void updateArrayDims(VarData &varData) const;
+  void setArrayDims(VarData &varData, const CPetBasic::Inds &dims) const;
+
+  void updateNameRows();
+
+  int variableRow(const std::string &name, bool isArray);
+
+  int insertVariable(const std::string &name, bool isArray);
+
+  void updateVariable(int row);
+
+  void updateArrayRows(int row, uint numValues);
+
+  const Value &varValue(const VarData &varData) const;
+  const Value &elementValue(const VarData &varData, uint i) const;
+
+  QString elementName(const VarData &varData, uint i) const;
+
  private:
   CQPetBasicVariables* variables_ { nullptr };
-  CQDataModel*         model_     { nullptr };
+  VarDatas             varDatas_;
+  NameRow              nameRows_;
+  NameRow              arrayNameRows_;
+  int                  numNames_  { 0 };
 };
 
 #endif
@@ -48,7 +48,7 @@ main(int argc, char **argv)
   //---
 
   if (run)
-    basic->run();
+    basic->postRun();
 
   //---
 
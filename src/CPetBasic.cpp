@@ -1,24 +1,42 @@
 #include <CPetBasic.h>
 #include <CPetBasicTerm.h>
 #include <CPetBasicRawTerm.h>
+#include <CPetBasicNullTerm.h>
+#include <CPetBasicInputScript.h>
+#include <CPetBasicTrace.h>
 #include <CPetBasicUtil.h>
 #include <CFileParse.h>
 #include <CStrParse.h>
 #include <CExpr.h>
 #include <CReadLine.h>
-#include <COSRand.h>
 #include <COSRead.h>
-#include <COSTime.h>
 
 #include <algorithm>
+#include <array>
+#include <chrono>
 #include <cmath>
+#include <regex>
 #include <sstream>
+#include <csignal>
+#include <ctime>
+#include <sys/syscall.h>
+#include <sys/time.h>
 #include <termios.h>
 #include <unistd.h>
 
+#ifndef sigev_notify_thread_id
+#define sigev_notify_thread_id _sigev_un._tid
+#endif
+
 //static int s_num_basic_tokens_created = 0;
 //static int s_num_basic_tokens_deleted = 0;
 
+// interpreter being sampled by SIGPROF handler, its profiling timer and the SIGPROF
+// action to restore when sampling stops
+static std::atomic<CPetBasic *> s_sampleBasic { nullptr };
+static timer_t                  s_sampleTimer;
+static struct sigaction         s_sampleOldAction;
+
 class CPetBasicExpr : public CExpr {
  public:
   using Inds = std::vector<uint>;
@@ -371,7 +389,7 @@ class CPetBasicRndFunction : public CPetBasicFunction {
     if (! values[0]->getRealValue(r))
       return errorMsg("Wrong argument type");
 
-    auto r1 = COSRand::randIn(0.0, 1.0);
+    auto r1 = basic_->randomValue();
 
     return expr_->createRealValue(r1);
   }
@@ -613,9 +631,7 @@ class CPetBasicTIVar : public CExprVariableObj {
   CPetBasicTIVar(CPetBasic *basic) : basic_(basic) { }
 
   CExprValuePtr get() const override {
-    auto l = long(time(nullptr));
-
-    return basic_->expr()->createIntegerValue(l);
+    return basic_->jiffiesValue();
   }
 
   void set(CExprValuePtr) override { /* NOOP */ }
@@ -629,10 +645,15 @@ class CPetBasicTISVar : public CExprVariableObj {
   CPetBasicTISVar(CPetBasic *basic) : basic_(basic) { }
 
   CExprValuePtr get() const override {
-    return basic_->expr()->createStringValue("");
+    return basic_->expr()->createStringValue(basic_->timeString());
   }
 
-  void set(CExprValuePtr) override { /* NOOP */ }
+  void set(CExprValuePtr value) override {
+    std::string str;
+
+    if (value->getStringValue(str))
+      (void) basic_->setTimeString(str);
+  }
 
  private:
   CPetBasic *basic_ { nullptr };
@@ -657,18 +678,24 @@ class CPetBasicStatusVar : public CExprVariableObj {
 CPetBasic::
 CPetBasic()
 {
-  COSRand::srand();
+  setRandomSeed(std::random_device()());
 
   initExpr();
 
   term_ = new CPetBasicTerm(this);
 
   term_->init();
+
+  resetMetrics();
 }
 
 CPetBasic::
 ~CPetBasic()
 {
+  stopSampling();
+
+  clearBreakpoints();
+
   clearLines();
 
   delete term_;
@@ -805,6 +832,9 @@ loadFile(const std::string &fileName)
 
   notifyLinesChanged();
 
+  // publish changes queued by run state reset (not running so no later flush)
+  flushNotify();
+
   return true;
 }
 
@@ -1712,19 +1742,35 @@ statementToString(const Statement &statement, char lastChar, bool highlight) con
 bool
 CPetBasic::
 run()
+{
+  startRun();
+
+  bool rc = contRun();
+
+  if (! isWaiting() && term()->col() > 0)
+    term_->enter();
+
+  return rc;
+}
+
+void
+CPetBasic::
+startRun()
 {
   initRunData();
 
   setLineInd(0, 0);
 
   breakLineNum_ = -1;
+  breakSkipInd_ = -1;
 
-  bool rc = contRun();
-
-  if (term()->col() > 0)
-    term_->enter();
+  clearWait();
 
-  return rc;
+  // trace run start with program size (checked on replay)
+  if      (traceRecord_)
+    trace_->add(CPetBasicTrace::RecordType::START, numStatements_);
+  else if (traceReplay_)
+    trace_->rewind();
 }
 
 bool
@@ -1774,6 +1820,12 @@ initRunData()
     setLineInd(0, 0);
 
     runDataValid_ = true;
+
+    updateStatementInds();
+
+    updateBreakBits();
+
+    clearProfile();
   }
 }
 
@@ -1811,10 +1863,56 @@ contRunTo(uint lineNum)
 bool
 CPetBasic::
 contRun()
+{
+  return (runLines(-1, 0) != RunStatus::ERROR);
+}
+
+CPetBasic::RunStatus
+CPetBasic::
+runFor(long maxStatements, long maxUSecs)
+{
+  // slices must not block so suspend on input/delay
+  auto resumable = isResumable();
+
+  setResumable(true);
+
+  auto status = runLines(maxStatements > 0 ? maxStatements : -1, maxUSecs);
+
+  setResumable(resumable);
+
+  return status;
+}
+
+CPetBasic::RunStatus
+CPetBasic::
+runLines(long maxStatements, long maxUSecs)
 {
   initRunData();
 
-  auto lineNum = currentLineNum();
+  // resume suspended statement (resumable mode)
+  if (isWaiting() && ! resumeWait()) {
+    term_->flush();
+
+    flushNotify();
+
+    warnMsg("Error: " + errorMsg_ + " @" + std::to_string(waitData_.lineRef.lineNum));
+
+    clearWait();
+
+    return RunStatus::ERROR;
+  }
+
+  auto startTime = (maxUSecs > 0 ? CPetBasicUtil::currentUSecs() : 0L);
+
+  statementBudget_ = maxStatements;
+
+  // don't stop again on break point we stopped at
+  watchHit_ = false;
+
+  if (breakSkipInd_ >= 0 && flatStatementInd() != breakSkipInd_)
+    breakSkipInd_ = -1;
+
+  auto lineNum = (! isWaiting() ? currentLineNum() : -1);
 
   while (lineNum > 0) {
     if (lineNum == breakLineNum_) {
@@ -1826,148 +1924,870 @@ contRun()
     assert(pl != lines_.end());
 
     if (! runLine((*pl).second)) {
+      term_->flush();
+
+      flushNotify();
+
       if (errorMsg_ != "")
         warnMsg("Error: " + errorMsg_ + " @" + std::to_string(lineNum));
       else
         warnMsg("Error: " + (*pl).second.line + " @" + std::to_string(lineNum));
-      return false;
+
+      statementBudget_ = -1;
+
+      return RunStatus::ERROR;
     }
 
-    if (isStopped())
+    if (isStopped() || isWaiting())
       break;
 
+    // flush coalesced terminal updates and notifications when due
+    {
+      SampleScope sampleScope(this, SampleCategory::TERMINAL);
+
+      term_->checkUpdate();
+    }
+
+    if (sampling_)
+      drainSamples();
+
+    checkNotify();
+
+    // slice used up (statement count or time)
+    if (statementBudget_ == 0 ||
+        (maxUSecs > 0 && CPetBasicUtil::currentUSecs() - startTime >= maxUSecs)) {
+      statementBudget_ = -1;
+
+      return RunStatus::RUNNING;
+    }
+
     lineNum = currentLineNum();
   }
 
-  setStopped(false);
+  statementBudget_ = -1;
 
-  return true;
+  if (! isWaiting())
+    setStopped(false);
+
+  term_->flush();
+
+  flushNotify();
+
+  return (isWaiting() ? RunStatus::WAITING : RunStatus::STOPPED);
 }
 
 //---
 
+bool
+CPetBasic::
+addBreakpoint(uint lineNum, uint statementNum, const std::string &condition)
+{
+  BreakData breakData;
+
+  breakData.lineNum      = lineNum;
+  breakData.statementNum = statementNum;
+  breakData.condition    = condition;
+
+  // compile condition once (evaluated each time break point bit is hit)
+  if (condition != "") {
+    LineData lineData;
+
+    if (! parseLineTokens(condition, lineData) || lineData.tokens.empty() ||
+        ! tokensToExpr(lineData.tokens, breakData.exprData)) {
+      for (auto *token : lineData.tokens)
+        delete token;
+
+      return errorMsg("Invalid break condition '" + condition + "'");
+    }
+
+    breakData.tokens = lineData.tokens;
+  }
+
+  removeBreakpoint(lineNum, statementNum);
+
+  breakpoints_[BreakKey(lineNum, statementNum)] = breakData;
+
+  updateBreakBits();
+
+  return true;
+}
+
 void
 CPetBasic::
-setRaw(bool b)
+removeBreakpoint(uint lineNum, uint statementNum)
 {
-  delete term_;
+  auto pb = breakpoints_.find(BreakKey(lineNum, statementNum));
 
-  if (b)
-    term_ = new CPetBasicRawTerm(this);
-  else
-    term_ = new CPetBasicTerm(this);
+  if (pb == breakpoints_.end())
+    return;
 
-  term_->init();
+  deleteBreakCondition((*pb).second);
+
+  breakpoints_.erase(pb);
+
+  updateBreakBits();
 }
 
-//---
+bool
+CPetBasic::
+hasBreakpoint(uint lineNum, uint statementNum) const
+{
+  return (breakpoints_.find(BreakKey(lineNum, statementNum)) != breakpoints_.end());
+}
 
 void
 CPetBasic::
-loop()
+clearBreakpoints()
 {
-  term_->loop();
+  for (auto &pb : breakpoints_)
+    deleteBreakCondition(pb.second);
+
+  breakpoints_.clear();
+
+  updateBreakBits();
 }
 
-bool
+void
 CPetBasic::
-inputLine(const std::string &lineBuffer)
+deleteBreakCondition(BreakData &breakData)
 {
-  LineData lineData;
+  for (auto *token : breakData.tokens)
+    delete token;
 
-  if (parseLine(0, lineBuffer, lineData)) {
-    processLineData(lineData);
+  breakData.tokens.clear();
 
-    if (lineData.lineN > 0) {
-      lines_[lineData.lineN] = lineData;
+  delete breakData.exprData.cstack;
 
-      runDataValid_ = false;
+  breakData.exprData.cstack = nullptr;
+}
 
-      notifyLinesChanged();
-    }
-    else {
-      if (! runLine(lineData)) {
-        if (errorMsg_ != "")
-          warnMsg("Invalid Line: " + lineBuffer + " (" + errorMsg_ + ")");
-        else
-          warnMsg("Invalid Line: " + lineBuffer);
-        return false;
-      }
-    }
+void
+CPetBasic::
+addVariableWatch(const std::string &name)
+{
+  variableWatches_.insert(CPetBasicUtil::toUpper(name));
+
+  updateBreakEnabled();
+}
+
+void
+CPetBasic::
+removeVariableWatch(const std::string &name)
+{
+  variableWatches_.erase(CPetBasicUtil::toUpper(name));
+
+  updateBreakEnabled();
+}
+
+void
+CPetBasic::
+addMemoryWatch(uint addr)
+{
+  memoryWatches_.insert(addr);
+
+  updateBreakEnabled();
+}
+
+void
+CPetBasic::
+removeMemoryWatch(uint addr)
+{
+  memoryWatches_.erase(addr);
+
+  updateBreakEnabled();
+}
+
+void
+CPetBasic::
+clearWatchpoints()
+{
+  variableWatches_.clear();
+  memoryWatches_  .clear();
+
+  updateBreakEnabled();
+}
+
+void
+CPetBasic::
+updateStatementInds()
+{
+  // flattened statement index of each line (same order as lineNums_)
+  statementInds_.clear();
+
+  numStatements_ = 0;
+
+  for (const auto &lineNum : lineNums_) {
+    statementInds_.push_back(numStatements_);
+
+    auto pl = lines_.find(lineNum);
+
+    if (pl != lines_.end())
+      numStatements_ += uint((*pl).second.statements.size());
   }
-  else {
-    warnMsg("Invalid Line: " + lineBuffer);
-    return false;
+}
+
+void
+CPetBasic::
+updateBreakBits()
+{
+  breakBits_.clear();
+  breakBits_.resize(numStatements_);
+
+  for (const auto &pb : breakpoints_) {
+    const auto &breakData = pb.second;
+
+    auto pi = lineInds_.find(breakData.lineNum);
+    if (pi == lineInds_.end()) continue;
+
+    auto lineInd = (*pi).second;
+    if (lineInd >= statementInds_.size()) continue;
+
+    auto ind = statementInds_[lineInd] + breakData.statementNum;
+
+    auto ind1 = (lineInd + 1 < statementInds_.size() ?
+                 statementInds_[lineInd + 1] : numStatements_);
+
+    if (ind < ind1)
+      breakBits_[ind] = true;
   }
 
-  return true;
+  updateBreakEnabled();
+}
+
+void
+CPetBasic::
+updateBreakEnabled()
+{
+  breakEnabled_ = (! breakpoints_.empty() || ! variableWatches_.empty() ||
+                   ! memoryWatches_.empty());
+}
+
+int
+CPetBasic::
+flatStatementInd() const
+{
+  if (lineInd_ < 0 || uint(lineInd_) >= statementInds_.size())
+    return -1;
+
+  return int(statementInds_[uint(lineInd_)] + statementNum_);
 }
 
 bool
 CPetBasic::
-runLine(LineData &lineData)
+checkBreak()
 {
-  notifyRunLine(lineData.lineN);
+  // watch point hit by previous statement
+  if (watchHit_) {
+    watchHit_ = false;
 
-  errorMsg_= "";
+    breakSkipInd_ = -1;
 
-  if (isDebug())
-    listLine(lineData);
+    return true;
+  }
 
-  bool nextLine = true;
+  auto ind = flatStatementInd();
 
-  auto numStatements = lineData.statements.size();
+  if (ind < 0 || uint(ind) >= breakBits_.size() || ! breakBits_[uint(ind)])
+    return false;
 
-  while (statementNum_ < numStatements) {
-    auto &statement = lineData.statements[statementNum_];
+  // resuming from this break point
+  if (ind == breakSkipInd_) {
+    breakSkipInd_ = -1;
+    return false;
+  }
 
-    if (! statement.compiled) {
-      if (! compileTokens(statement.tokens, statement.hasCompiled, statement.compiledTokens))
-        return false;
+  auto lineNum = uint(currentLineNum());
 
-      statement.compiled = true;
-    }
+  auto pb = breakpoints_.find(BreakKey(lineNum, statementNum_));
+  if (pb == breakpoints_.end()) return false;
 
-    LineRef lineRef(lineData.lineN, statementNum_);
+  const auto &breakData = (*pb).second;
 
-    if (! runTokens(lineRef, statement.compiledTokens, nextLine))
-      return false;
+  breakReason_ = "Break @" + std::to_string(lineNum);
 
-    if (! nextLine)
-      break;
+  if (breakData.condition != "") {
+    CExprValuePtr val;
 
-    ++statementNum_;
+    long ival = 0;
+
+    if (! evalExprData(breakData.exprData, val) || ! val || ! val->getIntegerValue(ival))
+      breakReason_ += " (invalid condition '" + breakData.condition + "')";
+    else if (! ival)
+      return false;
+    else
+      breakReason_ += " (" + breakData.condition + ")";
   }
 
-  if (nextLine)
-    setLineInd(lineInd_ + 1, 0);
+  breakSkipInd_ = ind;
 
   return true;
 }
 
+void
+CPetBasic::
+checkVariableWatch(const std::string &uname) const
+{
+  if (variableWatches_.find(uname) == variableWatches_.end())
+    return;
+
+  auto *th = const_cast<CPetBasic *>(this);
+
+  th->watchHit_    = true;
+  th->breakReason_ = "Watch " + uname + " @" + std::to_string(currentLineNum());
+}
+
+//---
+
+void
+CPetBasic::
+clearProfile()
+{
+  profileData_.clear();
+  profileData_.resize(numStatements_);
+}
+
 bool
 CPetBasic::
-compileTokens(const Tokens &tokens, bool &compiled, Tokens &compiledTokens)
+getLineProfile(uint lineNum, ProfileData &data) const
 {
-  compiled = false;
+  data = ProfileData();
 
-  auto nt = tokens.size();
-  assert(nt >= 1);
+  auto pi = lineInds_.find(lineNum);
+  if (pi == lineInds_.end()) return false;
 
-  uint it = 0;
+  auto lineInd = (*pi).second;
+  if (lineInd >= statementInds_.size()) return false;
 
-  auto *token = tokens[it++];
+  auto ind1 = statementInds_[lineInd];
+  auto ind2 = (lineInd + 1 < statementInds_.size() ? statementInds_[lineInd + 1] :
+               numStatements_);
 
-  if (token->type() == TokenType::KEYWORD) {
-    compiledTokens.push_back(token);
+  for (auto ind = ind1; ind < ind2 && ind < profileData_.size(); ++ind) {
+    data.count = std::max(data.count, profileData_[ind].count);
+    data.nsecs += profileData_[ind].nsecs;
+  }
 
-    TokenList tokenList(tokens);
+  return true;
+}
 
-    tokenList.skipToken(); // keyword
+void
+CPetBasic::
+printProfile(std::ostream &os, uint maxLines) const
+{
+  struct LineProfile {
+    uint        lineNum { 0 };
+    ProfileData data;
+  };
 
-    auto *keyword = static_cast<KeywordToken *>(token);
+  std::vector<LineProfile> lineProfiles;
 
-    switch (keyword->keywordType()) {
+  long totalNSecs = 0;
+
+  for (const auto &lineNum : lineNums_) {
+    LineProfile lineProfile;
+
+    lineProfile.lineNum = lineNum;
+
+    if (! getLineProfile(lineNum, lineProfile.data) || lineProfile.data.count == 0)
+      continue;
+
+    totalNSecs += lineProfile.data.nsecs;
+
+    lineProfiles.push_back(lineProfile);
+  }
+
+  std::sort(lineProfiles.begin(), lineProfiles.end(),
+            [](const LineProfile &lhs, const LineProfile &rhs) {
+    return lhs.data.nsecs > rhs.data.nsecs; });
+
+  auto formatNumber = [](double r, int w, int p) {
+    std::stringstream ss;
+    ss.setf(std::ios::fixed); ss.precision(p); ss.width(w);
+    ss << r;
+    return ss.str();
+  };
+
+  auto formatInteger = [](long i, int w) {
+    auto str = std::to_string(i);
+    while (int(str.size()) < w) str = " " + str;
+    return str;
+  };
+
+  os << "  Line      Count   Time(ms)      %  Source\n";
+
+  uint n = 0;
+
+  for (const auto &lineProfile : lineProfiles) {
+    if (maxLines > 0 && n >= maxLines)
+      break;
+
+    auto pl = lines_.find(lineProfile.lineNum);
+
+    auto percent = (totalNSecs > 0 ? 100.0*double(lineProfile.data.nsecs)/totalNSecs : 0.0);
+
+    os << formatInteger(lineProfile.lineNum, 6) << " " <<
+          formatInteger(lineProfile.data.count, 10) << " " <<
+          formatNumber(double(lineProfile.data.nsecs)/1000000.0, 10, 3) << " " <<
+          formatNumber(percent, 6, 2) << "  " <<
+          (pl != lines_.end() ? lineToString((*pl).second, false) : "") << "\n";
+
+    ++n;
+  }
+
+  os << "Total " << formatNumber(double(totalNSecs)/1000000.0, 0, 3) << "ms\n";
+}
+
+//---
+
+void
+CPetBasic::
+resetMetrics()
+{
+  metrics_.reset();
+
+  valueAllocBase_ = CExprValue::numCreated();
+}
+
+void
+CPetBasic::
+updateMetrics() const
+{
+  metrics_.set(CPetBasicMetrics::Metric::VALUE_ALLOCS,
+               CExprValue::numCreated() - valueAllocBase_);
+}
+
+//---
+
+bool
+CPetBasic::
+startSampling(long usecs)
+{
+  if (sampling_)
+    return true;
+
+  CPetBasic *basic = nullptr;
+
+  if (! s_sampleBasic.compare_exchange_strong(basic, this))
+    return errorMsg("Sampling already active");
+
+  sampleLineInd_ = -1;
+
+  struct sigaction sa;
+
+  sa.sa_handler = &CPetBasic::sampleSignal;
+  sa.sa_flags   = SA_RESTART;
+
+  sigemptyset(&sa.sa_mask);
+
+  sigaction(SIGPROF, &sa, &s_sampleOldAction);
+
+  // timer on the CPU time of the calling (interpreter) thread which only signals
+  // that thread (a process wide ITIMER_PROF can signal any thread, so other threads
+  // could run the handler concurrently and break the single producer queue)
+  struct sigevent sev {};
+
+  sev.sigev_notify           = SIGEV_THREAD_ID;
+  sev.sigev_signo            = SIGPROF;
+  sev.sigev_notify_thread_id = pid_t(syscall(SYS_gettid));
+
+  if (timer_create(CLOCK_THREAD_CPUTIME_ID, &sev, &s_sampleTimer) != 0) {
+    sigaction(SIGPROF, &s_sampleOldAction, nullptr);
+
+    s_sampleBasic = nullptr;
+
+    return errorMsg("Failed to create sampling timer");
+  }
+
+  // unblock in case the thread inherited a blocked mask
+  sigset_t mask;
+
+  sigemptyset(&mask);
+  sigaddset  (&mask, SIGPROF);
+
+  pthread_sigmask(SIG_UNBLOCK, &mask, nullptr);
+
+  struct itimerspec timer;
+
+  timer.it_interval.tv_sec  = usecs/1000000;
+  timer.it_interval.tv_nsec = (usecs % 1000000)*1000;
+  timer.it_value            = timer.it_interval;
+
+  timer_settime(s_sampleTimer, 0, &timer, nullptr);
+
+  sampling_ = true;
+
+  return true;
+}
+
+void
+CPetBasic::
+stopSampling()
+{
+  if (! sampling_)
+    return;
+
+  timer_delete(s_sampleTimer);
+
+  // deleting the timer discards a signal still pending from it so previous action
+  // can be restored
+  s_sampleBasic = nullptr;
+
+  sigaction(SIGPROF, &s_sampleOldAction, nullptr);
+
+  sampling_ = false;
+
+  drainSamples();
+}
+
+void
+CPetBasic::
+sampleSignal(int)
+{
+  // signal handler : only atomics and lock free queue push
+  auto *basic = s_sampleBasic.load();
+  if (! basic) return;
+
+  Sample sample;
+
+  sample.lineInd  = basic->sampleLineInd_ .load(std::memory_order_relaxed);
+  sample.category = basic->sampleCategory_.load(std::memory_order_relaxed);
+
+  if (! basic->sampleQueue_.push(sample))
+    ++basic->samplesDropped_;
+}
+
+void
+CPetBasic::
+drainSamples() const
+{
+  Sample sample;
+
+  while (sampleQueue_.pop(sample)) {
+    int lineNum = (sample.lineInd >= 0 ? lineIndNum(sample.lineInd) : 0);
+
+    auto pl = lineSamples_.find(lineNum);
+
+    if (pl == lineSamples_.end())
+      pl = lineSamples_.insert(pl, LineSamples::value_type(lineNum, SampleCounts()));
+
+    ++(*pl).second[size_t(sample.category)];
+  }
+}
+
+void
+CPetBasic::
+clearSamples()
+{
+  drainSamples();
+
+  lineSamples_.clear();
+
+  samplesDropped_ = 0;
+}
+
+void
+CPetBasic::
+printSamples(std::ostream &os, uint maxLines) const
+{
+  drainSamples();
+
+  static const char *categoryNames[] = { "interp", "expr", "variable", "terminal" };
+
+  static_assert(sizeof(categoryNames)/sizeof(categoryNames[0]) == size_t(SampleCategory::NUM),
+                "category names");
+
+  auto lineCount = [](const SampleCounts &counts) {
+    long n = 0;
+    for (const auto &count : counts) n += count;
+    return n;
+  };
+
+  auto percentStr = [](long n, long total) {
+    std::stringstream ss;
+    ss.setf(std::ios::fixed); ss.precision(2); ss.width(6);
+    ss << (total > 0 ? 100.0*double(n)/double(total) : 0.0);
+    return ss.str();
+  };
+
+  auto integerStr = [](long i, int w) {
+    auto str = std::to_string(i);
+    while (int(str.size()) < w) str = " " + str;
+    return str;
+  };
+
+  auto lineStr = [&](int lineNum) {
+    if (lineNum <= 0) return std::string("<direct>");
+
+    auto pl = lines_.find(uint(lineNum));
+
+    return (pl != lines_.end() ? lineToString((*pl).second, false) : std::string());
+  };
+
+  //---
+
+  long         total = 0;
+  SampleCounts categoryTotals { };
+
+  std::vector<std::pair<int, long>> lineTotals;
+
+  for (const auto &pl : lineSamples_) {
+    auto n = lineCount(pl.second);
+
+    for (size_t i = 0; i < pl.second.size(); ++i)
+      categoryTotals[i] += pl.second[i];
+
+    total += n;
+
+    lineTotals.push_back(std::make_pair(pl.first, n));
+  }
+
+  std::sort(lineTotals.begin(), lineTotals.end(),
+            [](const std::pair<int, long> &lhs, const std::pair<int, long> &rhs) {
+    return lhs.second > rhs.second; });
+
+  os << "Samples " << total << " (dropped " << samplesDropped_ << ")\n";
+
+  //---
+
+  // flat : lines by samples with breakdown by activity
+  os << "\n  Line   Samples      %";
+
+  for (const auto *name : categoryNames) {
+    auto nameStr = std::string(name);
+
+    os << " " << std::string(9 - nameStr.size(), ' ') << nameStr;
+  }
+
+  os << "  Source\n";
+
+  uint n = 0;
+
+  for (const auto &lt : lineTotals) {
+    if (maxLines > 0 && n++ >= maxLines)
+      break;
+
+    const auto &counts = lineSamples_.at(lt.first);
+
+    os << integerStr(lt.first, 6) << " " << integerStr(lt.second, 9) << " " <<
+          percentStr(lt.second, total);
+
+    for (const auto &count : counts)
+      os << " " << percentStr(count, lt.second).insert(0, 3, ' ');
+
+    os << "  " << lineStr(lt.first) << "\n";
+  }
+
+  //---
+
+  // inverted : activities by samples with lines sampled in each
+  for (size_t i = 0; i < size_t(SampleCategory::NUM); ++i) {
+    if (categoryTotals[i] == 0)
+      continue;
+
+    os << "\n" << categoryNames[i] << " " << categoryTotals[i] << " " <<
+          percentStr(categoryTotals[i], total) << "%\n";
+
+    std::vector<std::pair<int, long>> categoryLines;
+
+    for (const auto &pl : lineSamples_) {
+      if (pl.second[i] > 0)
+        categoryLines.push_back(std::make_pair(pl.first, pl.second[i]));
+    }
+
+    std::sort(categoryLines.begin(), categoryLines.end(),
+              [](const std::pair<int, long> &lhs, const std::pair<int, long> &rhs) {
+      return lhs.second > rhs.second; });
+
+    uint nl = 0;
+
+    for (const auto &cl : categoryLines) {
+      if (maxLines > 0 && nl++ >= maxLines)
+        break;
+
+      os << "  " << integerStr(cl.first, 6) << " " << integerStr(cl.second, 9) << " " <<
+            percentStr(cl.second, categoryTotals[i]) << "  " << lineStr(cl.first) << "\n";
+    }
+  }
+}
+
+//---
+
+void
+CPetBasic::
+setRaw(bool b)
+{
+  delete term_;
+
+  if (b)
+    term_ = new CPetBasicRawTerm(this);
+  else
+    term_ = new CPetBasicTerm(this);
+
+  term_->init();
+}
+
+void
+CPetBasic::
+setHeadless()
+{
+  delete term_;
+
+  term_ = new CPetBasicNullTerm(this);
+
+  term_->init();
+}
+
+//---
+
+void
+CPetBasic::
+loop()
+{
+  term_->loop();
+}
+
+bool
+CPetBasic::
+inputLine(const std::string &lineBuffer)
+{
+  LineData lineData;
+
+  if (parseLine(0, lineBuffer, lineData)) {
+    processLineData(lineData);
+
+    if (lineData.lineN > 0) {
+      lines_[lineData.lineN] = lineData;
+
+      runDataValid_ = false;
+
+      notifyLinesChanged();
+    }
+    else {
+      bool rc = runLine(lineData);
+
+      flushNotify();
+
+      if (! rc) {
+        if (errorMsg_ != "")
+          warnMsg("Invalid Line: " + lineBuffer + " (" + errorMsg_ + ")");
+        else
+          warnMsg("Invalid Line: " + lineBuffer);
+        return false;
+      }
+    }
+  }
+  else {
+    warnMsg("Invalid Line: " + lineBuffer);
+    return false;
+  }
+
+  return true;
+}
+
+bool
+CPetBasic::
+runLine(LineData &lineData)
+{
+  queueRunLine(lineData.lineN);
+
+  errorMsg_= "";
+
+  if (isDebug())
+    listLine(lineData);
+
+  bool nextLine = true;
+
+  auto numStatements = lineData.statements.size();
+
+  while (statementNum_ < numStatements) {
+    // statement budget (runFor) used up so continue from this statement next slice
+    if (statementBudget_ == 0)
+      return true;
+
+    if (statementBudget_ > 0)
+      --statementBudget_;
+
+    metrics_.add(CPetBasicMetrics::Metric::STATEMENTS);
+
+    // publish position for sampling profiler
+    if (sampling_)
+      sampleLineInd_.store(lineData.lineN > 0 ? lineInd_ : -1, std::memory_order_relaxed);
+
+    // break or watch point (program lines only)
+    if (breakEnabled_ && lineData.lineN > 0 && checkBreak()) {
+      setStopped(true);
+      return true;
+    }
+
+    if (trace_ && lineData.lineN > 0 && ! traceStatement())
+      return false;
+
+    auto &statement = lineData.statements[statementNum_];
+
+    if (! statement.compiled) {
+      if (! compileTokens(statement.tokens, statement.hasCompiled, statement.compiledTokens))
+        return false;
+
+      statement.compiled = true;
+    }
+
+    LineRef lineRef(lineData.lineN, statementNum_);
+
+    // profile program statements
+    int  profileInd   = -1;
+    long profileStart = 0;
+
+    if (profile_ && lineData.lineN > 0) {
+      profileInd   = flatStatementInd();
+      profileStart = CPetBasicUtil::currentNSecs();
+    }
+
+    if (! runTokens(lineRef, statement.compiledTokens, nextLine))
+      return false;
+
+    if (profileInd >= 0 && uint(profileInd) < profileData_.size()) {
+      auto &profileData = profileData_[uint(profileInd)];
+
+      ++profileData.count;
+
+      profileData.nsecs += CPetBasicUtil::currentNSecs() - profileStart;
+    }
+
+    if (! nextLine)
+      break;
+
+    ++statementNum_;
+  }
+
+  if (nextLine)
+    setLineInd(lineInd_ + 1, 0);
+
+  return true;
+}
+
+bool
+CPetBasic::
+compileTokens(const Tokens &tokens, bool &compiled, Tokens &compiledTokens)
+{
+  compiled = false;
+
+  auto nt = tokens.size();
+  assert(nt >= 1);
+
+  uint it = 0;
+
+  auto *token = tokens[it++];
+
+  if (token->type() == TokenType::KEYWORD) {
+    compiledTokens.push_back(token);
+
+    TokenList tokenList(tokens);
+
+    tokenList.skipToken(); // keyword
+
+    auto *keyword = static_cast<KeywordToken *>(token);
+
+    switch (keyword->keywordType()) {
 #ifdef PET_EXTRA_KEYWORDS
       case KeywordType::ASSERT:
         compiled = compileAssertStatement(tokenList, compiledTokens);
@@ -2041,7 +2861,9 @@ compileTokens(const Tokens &tokens, bool &compiled, Tokens &compiledTokens)
       case KeywordType::STOP:
         break;
       default:
-        std::cerr << "No compile for " << keyword->exprString() << "\n";
+        // no compile step (run from statement tokens)
+        if (isDebug())
+          std::cerr << "No compile for " << keyword->exprString() << "\n";
         break;
     }
   }
@@ -2332,85 +3154,541 @@ runTokens(const LineRef &lineRef, const Tokens &tokens, bool &nextLine)
         break;
     }
 
-    if (! rc || errorMsg_ != "")
-      return errorMsg(errorMsg_ != "" ? errorMsg_ : "Command failed");
+    if (! rc || errorMsg_ != "")
+      return errorMsg(errorMsg_ != "" ? errorMsg_ : "Command failed");
+
+    // statement suspended (resumable mode) so stop line and record innermost
+    // statement (may be inside IF) to run again on resume
+    if (isWaiting()) {
+      if (waitData_.tokens.empty()) {
+        waitData_.lineRef = lineRef;
+        waitData_.tokens  = tokens;
+      }
+
+      nextLine = false;
+    }
+  }
+  else if (token->type() == TokenType::VARIABLE) {
+    // <var> <inds> <expr>
+    assert(tokens.size() == 3);
+    auto *varToken = static_cast<VariableToken *>(token);
+
+    auto varName = varToken->str();
+
+    //---
+
+    assert(tokens[1]->type() == TokenType::TOKEN_LIST);
+    auto *indTokens = static_cast<TokenListToken *>(tokens[1]);
+
+    Inds inds;
+
+    if (! indTokens->tokens().empty()) {
+      for (const auto *itoken : indTokens->tokens()) {
+        assert(itoken->type() == TokenType::EXPR);
+        const auto *exprIToken = static_cast<const ExprToken *>(itoken);
+
+        CExprValuePtr val;
+        if (! exprIToken->eval(val))
+          return false;
+
+        long i;
+        if (! val->getIntegerValue(i) || i < 0)
+          return errorMsg("Invalid variable index value");
+
+        inds.push_back(uint(i));
+      };
+    }
+
+    //---
+
+    assert(tokens[2]->type() == TokenType::EXPR);
+    auto *exprToken = static_cast<ExprToken *>(tokens[2]);
+
+    CExprValuePtr val;
+    if (! exprToken->eval(val))
+      return false;
+
+    if (! inds.empty()) {
+      if (! setVariableValue(varName, inds, val))
+        return errorMsg("Failed to set variable value for '" + varName + "'");
+    }
+    else {
+      if (! setVariableValue(varName, val))
+        return errorMsg("Failed to set variable value for '" + varName + "'");
+    }
+  }
+  else
+    return errorMsg("Invalid run token " + token->listString());
+
+  return true;
+}
+
+//---
+
+void
+CPetBasic::
+setReverse(bool b)
+{
+  reverse_ = b;
+}
+
+void
+CPetBasic::
+setShift(bool b)
+{
+  shift_ = b;
+}
+
+void
+CPetBasic::
+setStopped(bool b)
+{
+  stopped_ = b;
+
+  // wake idle poll loop
+  if (b)
+    keyCond_.notify_all();
+}
+
+//---
+
+void
+CPetBasic::
+pushKey(uchar c)
+{
+  {
+  std::lock_guard<std::mutex> lock(keyMutex_);
+
+  (void) keyBuffer_.push(c);
+  }
+
+  keyCond_.notify_all();
+}
+
+bool
+CPetBasic::
+waitKey(long usecs)
+{
+  std::unique_lock<std::mutex> lock(keyMutex_);
+
+  keyCond_.wait_for(lock, std::chrono::microseconds(usecs),
+                    [&]() { return hasKey() || isStopped(); });
+
+  return hasKey();
+}
+
+bool
+CPetBasic::
+waitStopped(long usecs)
+{
+  std::unique_lock<std::mutex> lock(keyMutex_);
+
+  keyCond_.wait_for(lock, std::chrono::microseconds(usecs), [&]() { return isStopped(); });
+
+  return isStopped();
+}
+
+bool
+CPetBasic::
+loadInputScript(const std::string &fileName)
+{
+  auto inputScript = std::make_unique<CPetBasicInputScript>();
+
+  if (! inputScript->load(fileName))
+    return errorMsg(inputScript->errorMsg());
+
+  inputScript_ = std::move(inputScript);
+
+  inputScriptWait_ = -1;
+
+  return true;
+}
+
+void
+CPetBasic::
+clearInputScript()
+{
+  inputScript_.reset();
+}
+
+bool
+CPetBasic::
+feedInputScript(bool idle)
+{
+  if (! inputScript_ || hasKey())
+    return false;
+
+  // statements since program started reading keys (metrics may have been reset)
+  auto statements = metrics_.value(CPetBasicMetrics::Metric::STATEMENTS);
+
+  if (inputScriptWait_ < 0 || statements < inputScriptWait_)
+    inputScriptWait_ = statements;
+
+  std::string keys;
+
+  if (! inputScript_->nextKeys(statements - inputScriptWait_, idle, keys))
+    return false;
+
+  inputScriptWait_ = -1;
+
+  pushKeys(keys);
+
+  return true;
+}
+
+//---
+
+void
+CPetBasic::
+setRandomSeed(ulong seed)
+{
+  random_.seed(std::mt19937::result_type(seed));
+}
+
+double
+CPetBasic::
+randomValue()
+{
+  using RecordType = CPetBasicTrace::RecordType;
+
+  double r = 0.0;
+
+  if (traceReplay_) {
+    if (trace_->nextDouble(RecordType::RND, r))
+      return r;
+
+    // stop after current line (can't fail here)
+    (void) traceDiverged("expected RND");
+
+    warnMsg("Error: " + errorMsg_);
+
+    setStopped(true);
+  }
+
+  r = std::uniform_real_distribution<double>(0.0, 1.0)(random_);
+
+  if (traceRecord_)
+    trace_->addDouble(RecordType::RND, r);
+
+  return r;
+}
+
+//---
+
+void
+CPetBasic::
+setVirtualClock(bool b, long statementUSecs)
+{
+  clock_.setVirtual(b, statementUSecs);
+
+  jiffiesValue_ = CExprValuePtr();
+}
+
+long
+CPetBasic::
+jiffies()
+{
+  using RecordType = CPetBasicTrace::RecordType;
+
+  if (traceReplay_) {
+    CPetBasicTrace::Record record;
+
+    if (trace_->next(record) && record.type == RecordType::TIME)
+      return long(record.value);
+
+    // stop after current line (can't fail here)
+    (void) traceDiverged("expected TIME");
+
+    warnMsg("Error: " + errorMsg_);
+
+    setStopped(true);
+  }
+
+  auto j = clock_.jiffies(metrics_.value(CPetBasicMetrics::Metric::STATEMENTS));
+
+  if (traceRecord_)
+    trace_->add(RecordType::TIME, uint32_t(j));
+
+  return j;
+}
+
+std::string
+CPetBasic::
+timeString()
+{
+  return CPetBasicClock::jiffiesToString(jiffies());
+}
+
+bool
+CPetBasic::
+setTimeString(const std::string &str)
+{
+  // HHMMSS (set from variable assign so stop after current line on error)
+  if (! clock_.setTimeString(str, metrics_.value(CPetBasicMetrics::Metric::STATEMENTS))) {
+    (void) errorMsg("Invalid TI$ value '" + str + "'");
+
+    warnMsg("Error: " + errorMsg_);
+
+    setStopped(true);
+
+    return false;
+  }
+
+  return true;
+}
+
+CExprValuePtr
+CPetBasic::
+jiffiesValue()
+{
+  auto j = jiffies();
+
+  // TI is read in loops far more often than it changes so reuse value for same jiffy
+  // (checked as value could have been changed in place)
+  long j1;
+
+  if (! jiffiesValue_ || ! jiffiesValue_->getIntegerValue(j1) || j1 != j)
+    jiffiesValue_ = expr_->createIntegerValue(j);
+
+  return jiffiesValue_;
+}
+
+//---
+
+bool
+CPetBasic::
+startTraceRecord(const std::string &fileName, size_t capacity)
+{
+  auto trace = std::make_unique<CPetBasicTrace>();
+
+  if (! trace->create(fileName, capacity))
+    return errorMsg(trace->errorMsg());
+
+  trace_ = std::move(trace);
+
+  traceRecord_ = true;
+  traceReplay_ = false;
+
+  return true;
+}
+
+bool
+CPetBasic::
+startTraceReplay(const std::string &fileName)
+{
+  auto trace = std::make_unique<CPetBasicTrace>();
+
+  if (! trace->load(fileName))
+    return errorMsg(trace->errorMsg());
+
+  // replay needs whole run
+  if (trace->isWrapped())
+    return errorMsg("Trace '" + fileName + "' has wrapped (start of run lost)");
+
+  trace_ = std::move(trace);
+
+  traceRecord_ = false;
+  traceReplay_ = true;
+
+  return true;
+}
+
+void
+CPetBasic::
+stopTrace()
+{
+  trace_.reset();
+
+  traceRecord_ = false;
+  traceReplay_ = false;
+}
+
+bool
+CPetBasic::
+statementLine(uint ind, uint &lineNum, uint &statementNum) const
+{
+  if (ind >= numStatements_ || statementInds_.empty())
+    return false;
+
+  // last line whose first statement is at or before index
+  auto p = std::upper_bound(statementInds_.begin(), statementInds_.end(), ind);
+
+  auto lineInd = uint(p - statementInds_.begin()) - 1;
+
+  if (lineInd >= lineNums_.size())
+    return false;
+
+  lineNum      = lineNums_[lineInd];
+  statementNum = ind - statementInds_[lineInd];
+
+  return true;
+}
+
+bool
+CPetBasic::
+traceStatement()
+{
+  using RecordType = CPetBasicTrace::RecordType;
+
+  auto ind = uint(flatStatementInd());
+
+  if (traceRecord_) {
+    trace_->add(RecordType::STATEMENT, ind);
+    return true;
   }
-  else if (token->type() == TokenType::VARIABLE) {
-    // <var> <inds> <expr>
-    assert(tokens.size() == 3);
-    auto *varToken = static_cast<VariableToken *>(token);
 
-    auto varName = varToken->str();
+  if (! traceReplay_)
+    return true;
 
-    //---
+  // end of recorded run so continue live
+  if (trace_->atEnd()) {
+    warnMsg("End of trace replay @" + std::to_string(currentLineNum()));
 
-    assert(tokens[1]->type() == TokenType::TOKEN_LIST);
-    auto *indTokens = static_cast<TokenListToken *>(tokens[1]);
+    traceReplay_ = false;
 
-    Inds inds;
+    setStopped(true);
 
-    if (! indTokens->tokens().empty()) {
-      for (const auto *itoken : indTokens->tokens()) {
-        assert(itoken->type() == TokenType::EXPR);
-        const auto *exprIToken = static_cast<const ExprToken *>(itoken);
+    return true;
+  }
 
-        CExprValuePtr val;
-        if (! exprIToken->eval(val))
-          return false;
+  CPetBasicTrace::Record record;
 
-        long i;
-        if (! val->getIntegerValue(i) || i < 0)
-          return errorMsg("Invalid variable index value");
+  (void) trace_->next(record);
 
-        inds.push_back(uint(i));
-      };
-    }
+  if (record.type == RecordType::START) {
+    if (record.value != numStatements_)
+      return traceDiverged("trace is for a different program");
 
-    //---
+    if (! trace_->next(record))
+      return traceDiverged("no statements");
+  }
 
-    assert(tokens[2]->type() == TokenType::EXPR);
-    auto *exprToken = static_cast<ExprToken *>(tokens[2]);
+  if (record.type != RecordType::STATEMENT || record.value != ind)
+    return traceDiverged("expected statement " + std::to_string(record.value));
 
-    CExprValuePtr val;
-    if (! exprToken->eval(val))
-      return false;
+  return true;
+}
 
-    if (! inds.empty()) {
-      if (! setVariableValue(varName, inds, val))
-        return errorMsg("Failed to set variable value for '" + varName + "'");
-    }
-    else {
-      if (! setVariableValue(varName, val))
-        return errorMsg("Failed to set variable value for '" + varName + "'");
-    }
+bool
+CPetBasic::
+traceBranch(bool b)
+{
+  using RecordType = CPetBasicTrace::RecordType;
+
+  auto ind = uint(flatStatementInd());
+
+  if (traceRecord_) {
+    trace_->add(RecordType::BRANCH, ind, b);
+    return true;
   }
-  else
-    return errorMsg("Invalid run token " + token->listString());
+
+  if (! traceReplay_)
+    return true;
+
+  CPetBasicTrace::Record record;
+
+  if (! trace_->next(record) || record.type != RecordType::BRANCH ||
+      record.value != ind || (record.aux != 0) != b)
+    return traceDiverged("IF result differs");
 
   return true;
 }
 
-//---
+bool
+CPetBasic::
+traceGet(uchar &c)
+{
+  using RecordType = CPetBasicTrace::RecordType;
 
-void
+  if (traceRecord_) {
+    trace_->add(RecordType::GET, c);
+    return true;
+  }
+
+  if (! traceReplay_)
+    return true;
+
+  CPetBasicTrace::Record record;
+
+  if (! trace_->next(record) || record.type != RecordType::GET)
+    return traceDiverged("expected GET");
+
+  c = uchar(record.value);
+
+  return true;
+}
+
+bool
 CPetBasic::
-setReverse(bool b)
+traceInput(std::string &line)
 {
-  reverse_ = b;
+  using RecordType = CPetBasicTrace::RecordType;
+
+  if (traceRecord_) {
+    for (const auto &c : line)
+      trace_->add(RecordType::INPUT, uchar(c));
+
+    trace_->add(RecordType::INPUT_END, 0);
+
+    return true;
+  }
+
+  if (! traceReplay_)
+    return true;
+
+  line.clear();
+
+  CPetBasicTrace::Record record;
+
+  while (true) {
+    if (! trace_->next(record))
+      return traceDiverged("expected INPUT");
+
+    if (record.type == RecordType::INPUT_END)
+      break;
+
+    if (record.type != RecordType::INPUT)
+      return traceDiverged("expected INPUT");
+
+    line += char(record.value);
+  }
+
+  return true;
 }
 
-void
+bool
 CPetBasic::
-setShift(bool b)
+traceDiverged(const std::string &msg)
 {
-  shift_ = b;
+  auto ind = (trace_ ? trace_->readInd() : 0);
+
+  traceReplay_ = false;
+
+  return errorMsg("Trace replay diverged at record " + std::to_string(ind) + " : " + msg);
 }
 
-void
+bool
 CPetBasic::
-setStopped(bool b)
+isPollLoopLine(const LineData &lineData) const
 {
-  stopped_ = b;
+  if (lineData.pollLoop < 0) {
+    // match on source text with spaces removed
+    std::string str;
+
+    for (const auto &c : lineData.line) {
+      if (! isspace(c))
+        str += char(toupper(c));
+    }
+
+    static std::regex re("^[0-9]*GET([A-Z][A-Z0-9]*\\$):IF\\1=\"\"(THEN|GOTO|THENGOTO)([0-9]+)(:REM.*)?$");
+
+    std::smatch match;
+
+    lineData.pollLoop = (std::regex_match(str, match, re) &&
+                         std::stol(match[3].str()) == long(lineData.lineN));
+  }
+
+  return lineData.pollLoop;
 }
 
 //---
@@ -2452,6 +3730,11 @@ setMemory(uint addr, uchar value)
 {
   memory_[addr] = value;
 
+  if (breakEnabled_ && memoryWatches_.find(addr) != memoryWatches_.end()) {
+    watchHit_    = true;
+    breakReason_ = "Watch " + std::to_string(addr) + " @" + std::to_string(currentLineNum());
+  }
+
   if (addr >= 0x8000 && addr <= 0x87ff) {
     uint pos = addr - 0x8000;
 
@@ -2711,7 +3994,9 @@ clrStatement(const Tokens &tokens)
 
   initExpr();
 
-  notifyVariablesChanged();
+  queueVariablesChanged();
+
+  flushNotify();
 
   return true;
 }
@@ -2933,6 +4218,16 @@ delayStatement(const Tokens &tokens)
   auto nt = tokens.size();
   assert(nt == 2);
 
+  // resumed : wait until end time
+  if (waitData_.resuming) {
+    waitData_.resuming = false;
+
+    if (CPetBasicUtil::currentUSecs() >= waitData_.endTime)
+      clearWait();
+
+    return true;
+  }
+
   assert(tokens[1]->type() == TokenType::EXPR);
   auto *exprToken = static_cast<ExprToken *>(tokens[1]);
 
@@ -2944,6 +4239,21 @@ delayStatement(const Tokens &tokens)
   if (! val->getIntegerValue(i))
     return errorMsg("Invalid DELAY expression");
 
+  flushNotify();
+
+  // virtual clock moves on by delay (however long the real wait is)
+  clock_.addDelay(1000*i);
+
+  if (isResumable()) {
+    term_->flush();
+
+    suspend(WaitType::DELAY);
+
+    waitData_.endTime = CPetBasicUtil::currentUSecs() + 1000*i;
+
+    return true;
+  }
+
   term_->delay(i);
 
   return true;
@@ -3071,19 +4381,13 @@ bool
 CPetBasic::
 elapsedStatement(const Tokens &)
 {
-  static CHRTime lastTime;
-  static bool    lastTimeSet { false };
-
-  auto t = COSTime::getHRTime();
-
-  if (lastTimeSet) {
-    auto dt = COSTime::diffHRTime(lastTime, t);
+  // usecs since last ELAPSED (from jiffy clock so repeatable with virtual clock)
+  auto t = clock_.usecs(metrics_.value(CPetBasicMetrics::Metric::STATEMENTS));
 
-    std::cerr << "Elapsed: " << dt.usecs << "\n";
-  }
+  if (elapsedUSecs_ >= 0)
+    std::cerr << "Elapsed: " << t - elapsedUSecs_ << "\n";
 
-  lastTime    = t;
-  lastTimeSet = true;
+  elapsedUSecs_ = t;
 
   return true;
 }
@@ -3293,6 +4597,8 @@ forStatement(const LineRef &lineRef, const Tokens &tokens)
   auto fromVal1 = CExprValuePtr(fromVal->dup());
   var->setValue(fromVal1);
 
+  queueVariableChanged(var->name());
+
   //---
 
   auto varName = CPetBasicUtil::toUpper(varToken->str());
@@ -3345,8 +4651,85 @@ getStatement(TokenList &tokenList)
   else if (token->type() != TokenType::SEPARATOR)
     return errorMsg("Invalid GET token '" + token->str() + "'");
 
+  flushNotify();
+
+  // replay : key comes from trace
+  if (traceReplay_) {
+    uchar c = '\0';
+
+    if (! traceGet(c))
+      return false;
+
+    std::string s;
+    if (c) { s += char(c); }
+
+    return setVariableValue(varName, expr_->createStringValue(s));
+  }
+
+  auto *lineData = getLineIndData(lineInd_);
+
+  bool pollLoop = (lineData && isPollLoopLine(*lineData));
+
+  if (inputScript_)
+    (void) feedInputScript(pollLoop);
+
+  // resumable : read from keyboard buffer and suspend (instead of park) in idle poll loop
+  if (isResumable()) {
+    if (waitData_.resuming)
+      clearWait();
+
+    uchar c1 = '\0';
+
+    if (! popKey(c1)) {
+      metrics_.add(CPetBasicMetrics::Metric::GET_POLLS);
+
+      if (pollLoop) {
+        term_->flush();
+
+        suspend(WaitType::GET);
+
+        return true;
+      }
+    }
+
+    c1 = uchar(toupper(c1));
+
+    if (trace_ && ! traceGet(c1))
+      return false;
+
+    std::string s;
+    if (c1) { s += char(c1); }
+
+    auto val = expr_->createStringValue(s);
+
+    return setVariableValue(varName, val);
+  }
+
   auto c = term_->readChar();
 
+  // park interpreter in an idle keyboard poll loop (only GET and the empty test are
+  // run, so nothing, including TI, can change until a key arrives). The GET result
+  // is unchanged so the loop just runs again when a key is available.
+  if (! c) {
+    metrics_.add(CPetBasicMetrics::Metric::GET_POLLS);
+
+    if (pollLoop) {
+      auto t1 = CPetBasicUtil::currentUSecs();
+
+      (void) term_->waitKey(idleWait_);
+
+      metrics_.add(CPetBasicMetrics::Metric::INPUT_WAIT_USECS,
+                   CPetBasicUtil::currentUSecs() - t1);
+    }
+  }
+
+  if (trace_) {
+    auto c1 = uchar(c);
+
+    if (! traceGet(c1))
+      return false;
+  }
+
   std::string s;
   if (c) { s += c; }
 
@@ -3583,6 +4966,9 @@ ifStatement(const LineRef &lineRef, const Tokens &tokens, bool &nextLine)
   if (! val->getIntegerValue(ival))
     return errorMsg("Invalid IF expression");
 
+  if (trace_ && ! traceBranch(ival != 0))
+    return false;
+
   //---
 
   // if expression false then goto next line
@@ -3624,49 +5010,159 @@ ifStatement(const LineRef &lineRef, const Tokens &tokens, bool &nextLine)
     // must be single number after goto
     assert(nt == 4 && tokens[3]->type() == TokenType::NUMBER);
 
-    auto lineNum = uint(tokens[3]->toInteger());
-    //std::cout << "GOTO " << lineNum << "\n";
+    auto lineNum = uint(tokens[3]->toInteger());
+    //std::cout << "GOTO " << lineNum << "\n";
+
+    auto lineInd = getLineInd(lineNum);
+    if (lineInd < 0) return errorMsg("Invalid IF <expr> GOTO line");
+
+    setLineInd(lineInd, 0);
+    nextLine = false;
+  }
+
+  return true;
+}
+
+bool
+CPetBasic::
+inputStatement(TokenList &tokenList)
+{
+  std::string prompt;
+
+  auto *token = tokenList.nextToken();
+
+  if (token && token->type() == TokenType::STRING) {
+    prompt = token->toString();
+
+    token = tokenList.nextToken();
+  }
+
+  using VarNames = std::vector<std::string>;
+
+  VarNames varNames;
+
+  while (token) {
+    if      (token->type() == TokenType::VARIABLE)
+      varNames.push_back(token->toString());
+    else if (token->type() != TokenType::SEPARATOR)
+      return errorMsg("Invalid INPUT token '" + token->str() + "'");
+
+    token = tokenList.nextToken();
+  }
+
+  flushNotify();
+
+  // replay : lines come from trace (prompt and line echoed)
+  if (traceReplay_) {
+    for (const auto &varName : varNames) {
+      std::string line;
+
+      if (! traceInput(line))
+        return false;
+
+      printString(prompt + "? " + line + "\n");
+
+      if (! setVariableValue(varName, expr_->createStringValue(line)))
+        return false;
+    }
+
+    return true;
+  }
+
+  // resumable : prompt and suspend, then read keys (echoed) until RETURN for each variable
+  if (isResumable()) {
+    if (! waitData_.resuming) {
+      printString(prompt + "? ");
+
+      term_->flush();
+
+      suspend(WaitType::INPUT);
+
+      if (inputScript_)
+        (void) feedInputScript(/*idle*/true);
+
+      return true;
+    }
+
+    waitData_.resuming = false;
+
+    bool done = false;
+
+    uchar c;
+
+    while (! done && popKey(c)) {
+      if      (c == '\r')
+        done = true;
+      else if (c == 20) { // DEL
+        if (! waitData_.input.empty()) {
+          waitData_.input.pop_back();
+
+          term_->del();
+        }
+      }
+      else {
+        waitData_.input += char(c);
+
+        if (term_->drawChar(c))
+          term_->cursorRight();
+      }
+    }
+
+    if (! done) {
+      if (inputScript_)
+        (void) feedInputScript(/*idle*/true);
+
+      term_->update();
+      return true;
+    }
+
+    // RETURN moves to next line
+    printString("\n");
 
-    auto lineInd = getLineInd(lineNum);
-    if (lineInd < 0) return errorMsg("Invalid IF <expr> GOTO line");
+    auto line = CPetBasicUtil::toUpper(waitData_.input);
 
-    setLineInd(lineInd, 0);
-    nextLine = false;
-  }
+    if (trace_ && ! traceInput(line))
+      return false;
 
-  return true;
-}
+    auto val = expr_->createStringValue(line);
 
-bool
-CPetBasic::
-inputStatement(TokenList &tokenList)
-{
-  std::string prompt;
+    if (waitData_.varInd < varNames.size() &&
+        ! setVariableValue(varNames[waitData_.varInd], val))
+      return false;
 
-  auto *token = tokenList.nextToken();
+    // prompt for next variable
+    if (++waitData_.varInd < varNames.size()) {
+      waitData_.input.clear();
 
-  if (token && token->type() == TokenType::STRING) {
-    prompt = token->toString();
+      printString(prompt + "? ");
 
-    token = tokenList.nextToken();
-  }
+      term_->flush();
 
-  using VarNames = std::vector<std::string>;
+      if (inputScript_)
+        (void) feedInputScript(/*idle*/true);
 
-  VarNames varNames;
+      return true;
+    }
 
-  while (token) {
-    if      (token->type() == TokenType::VARIABLE)
-      varNames.push_back(token->toString());
-    else if (token->type() != TokenType::SEPARATOR)
-      return errorMsg("Invalid INPUT token '" + token->str() + "'");
+    clearWait();
 
-    token = tokenList.nextToken();
+    return true;
   }
 
   for (const auto &varName : varNames) {
+    if (inputScript_)
+      (void) feedInputScript(/*idle*/true);
+
+    auto t1 = CPetBasicUtil::currentUSecs();
+
     auto line = term_->readString(prompt);
 
+    metrics_.add(CPetBasicMetrics::Metric::INPUT_WAIT_USECS,
+                 CPetBasicUtil::currentUSecs() - t1);
+
+    if (trace_ && ! traceInput(line))
+      return false;
+
     auto val = expr_->createStringValue(line);
 
     if (! setVariableValue(varName, val))
@@ -3941,6 +5437,8 @@ newStatement(const Tokens &tokens)
 
   notifyLinesChanged();
 
+  flushNotify();
+
   return true;
 }
 
@@ -3951,13 +5449,16 @@ clearLines()
   for (auto &pl : lines_) {
     auto &lineData = pl.second;
 
-    for (auto *token : lineData.tokens)
-      delete token;
+    // compiled statements can reuse line tokens so only delete the ones they created
+    std::set<Token *> lineTokens(lineData.tokens.begin(), lineData.tokens.end());
 
     for (auto &statement : lineData.statements) {
       if (! statement.hasCompiled) continue;
 
       for (auto *ctoken : statement.compiledTokens) {
+        if (lineTokens.find(ctoken) != lineTokens.end())
+          continue;
+
         if (ctoken->type() == TokenType::KEYWORD ||
             ctoken->type() == TokenType::VARIABLE ||
             ctoken->type() == TokenType::NUMBER)
@@ -3966,6 +5467,9 @@ clearLines()
         delete ctoken;
       }
     }
+
+    for (auto *token : lineData.tokens)
+      delete token;
   }
 
   lines_.clear();
@@ -4028,7 +5532,7 @@ nextStatement(const LineRef &lineRef, const Tokens &tokens)
     varName = forData.varName();
 
   auto var = getVariable(varName);
-  auto val = var->value();
+  auto val = var->getValue();
 
   long fromI;
 
@@ -4050,6 +5554,8 @@ nextStatement(const LineRef &lineRef, const Tokens &tokens)
 
   var->setValue(val);
 
+  queueVariableChanged(varName);
+
   long toI;
   if (! forData.toVal()->getIntegerValue(toI))
     return errorMsg("Invalid FOR TO value");
@@ -4246,7 +5752,8 @@ plotStatement(const Tokens &tokens)
     ivalues.push_back(ivalue);
   }
 
-  term_->drawPoint(ivalues[0], ivalues[1], ivalues[2]);
+  // points outside framebuffer are ignored
+  (void) term_->plot(ivalues[0], ivalues[1], ivalues[2]);
 
   return true;
 }
@@ -4997,9 +6504,87 @@ initRunState()
 
   errorMsg_ = "";
 
+  clearWait();
+
   setLineInd(-1, 0);
 }
 
+//---
+
+void
+CPetBasic::
+suspend(WaitType type)
+{
+  waitData_ = WaitData();
+
+  waitData_.type = type;
+}
+
+bool
+CPetBasic::
+resumeWait()
+{
+  // run suspended statement again (statement continues from saved state)
+  auto lineRef = waitData_.lineRef;
+  auto tokens  = waitData_.tokens;
+
+  waitData_.resuming = true;
+
+  bool nextLine = true;
+
+  if (! runTokens(lineRef, tokens, nextLine))
+    return false;
+
+  if (isWaiting())
+    return true;
+
+  // continue with rest of line
+  if (nextLine)
+    ++statementNum_;
+
+  return true;
+}
+
+void
+CPetBasic::
+clearWait()
+{
+  waitData_ = WaitData();
+}
+
+bool
+CPetBasic::
+canResume() const
+{
+  switch (waitData_.type) {
+    case WaitType::INPUT:
+    case WaitType::GET:
+      return hasKey();
+    case WaitType::DELAY:
+      return (CPetBasicUtil::currentUSecs() >= waitData_.endTime);
+    default:
+      return true;
+  }
+}
+
+long
+CPetBasic::
+waitRemaining() const
+{
+  if (waitData_.type != WaitType::DELAY)
+    return 0;
+
+  return std::max(waitData_.endTime - CPetBasicUtil::currentUSecs(), 0L);
+}
+
+void
+CPetBasic::
+skipDelay()
+{
+  if (waitData_.type == WaitType::DELAY)
+    waitData_.endTime = 0;
+}
+
 void
 CPetBasic::
 setLineInd(int lineInd, int statementNum)
@@ -5008,8 +6593,98 @@ setLineInd(int lineInd, int statementNum)
     lineInd_      = lineInd;
     statementNum_ = statementNum;
 
-    notifyLineNumChanged();
+    queueLineNumChanged();
+  }
+}
+
+//---
+
+void
+CPetBasic::
+checkNotify()
+{
+  if (! changes_.isSet())
+    return;
+
+  // publish if enough time has passed since last publish
+  if (maxNotifyRate_ > 0.0) {
+    auto t = CPetBasicUtil::currentUSecs();
+
+    if (double(t - lastNotifyTime_) < 1000000.0/maxNotifyRate_)
+      return;
   }
+
+  flushNotify();
+}
+
+void
+CPetBasic::
+flushNotify()
+{
+  if (! changes_.isSet())
+    return;
+
+  // take copy so notify methods can queue new changes
+  auto changes = changes_;
+
+  changes_ = Changes();
+
+  lastNotifyTime_ = CPetBasicUtil::currentUSecs();
+
+  if (changes.runLine)
+    notifyRunLine(changes.runLineNum);
+
+  if (changes.lineNumChanged)
+    notifyLineNumChanged();
+
+  if (changes.variables.isSet())
+    notifyVariablesChanged(changes.variables);
+}
+
+void
+CPetBasic::
+queueVariablesChanged() const
+{
+  changes_.variables.reset = true;
+
+  changes_.variables.names     .clear();
+  changes_.variables.arrayNames.clear();
+}
+
+void
+CPetBasic::
+queueVariableChanged(const std::string &uname) const
+{
+  if (breakEnabled_)
+    checkVariableWatch(uname);
+
+  auto &variables = changes_.variables;
+
+  if (variables.reset)
+    return;
+
+  variables.names.insert(uname);
+
+  if (variables.names.size() + variables.arrayNames.size() > maxVariableChanges)
+    queueVariablesChanged();
+}
+
+void
+CPetBasic::
+queueArrayVariableChanged(const std::string &uname) const
+{
+  if (breakEnabled_)
+    checkVariableWatch(uname);
+
+  auto &variables = changes_.variables;
+
+  if (variables.reset)
+    return;
+
+  variables.arrayNames.insert(uname);
+
+  if (variables.names.size() + variables.arrayNames.size() > maxVariableChanges)
+    queueVariablesChanged();
 }
 
 //---
@@ -5018,6 +6693,8 @@ void
 CPetBasic::
 printString(const std::string &str) const
 {
+  SampleScope sampleScope(this, SampleCategory::TERMINAL);
+
 #if 1
   auto *th = const_cast<CPetBasic *>(this);
 
@@ -5025,12 +6702,38 @@ printString(const std::string &str) const
   uint i   = 0;
   auto len = str.length();
 
+  // run of plain chars drawn in one call
+  std::string run;
+
+  auto flushRun = [&]() {
+    if (! run.empty()) {
+      term_->drawString(run);
+
+      run.clear();
+    }
+  };
+
   //---
 
   while (i < len) {
     auto c  = str[i];
     auto c1 = uchar(c);
 
+    // handle normal char
+    if (c1 < 128 && c != '\n' && c != '\t' && c1 != 17 && c1 != 18 && c1 != 19 && c1 != 29) {
+      // map to upper case
+      if (islower(c))
+        c = char(toupper(c));
+
+      run += c;
+
+      ++i;
+
+      continue;
+    }
+
+    flushRun();
+
     // handle new line
     if      (c == '\n') {
       term_->enter();
@@ -5076,24 +6779,14 @@ printString(const std::string &str) const
 
         if (term_->drawChar(drawChar))
           term_->cursorRight();
-
-        handled = true;
-      }
-
-      // handle normal char
-      if (! handled) {
-        // map to upper case
-        if (islower(c))
-          c = char(toupper(c));
-
-        if (term_->drawChar(c))
-          term_->cursorRight();
       }
     }
 
     ++i;
   }
 
+  flushRun();
+
   term_->update();
 #else
   for (const auto &c : s) {
@@ -5358,6 +7051,10 @@ bool
 CPetBasic::
 evalExprData(const ExprData &exprData, CExprValuePtr &val) const
 {
+  SampleScope sampleScope(this, SampleCategory::EXPR);
+
+  metrics_.add(CPetBasicMetrics::Metric::EXPRESSIONS);
+
   if (exprData.value) {
     val = exprData.value;
   }
@@ -5399,7 +7096,7 @@ addVariable(const std::string &name, const CExprValuePtr &value)
 
   variableNames_.insert(name);
 
-  notifyVariablesChanged();
+  queueVariableChanged(name);
 
   return var;
 }
@@ -5408,6 +7105,10 @@ CExprVariablePtr
 CPetBasic::
 getVariable(const std::string &name) const
 {
+  SampleScope sampleScope(this, SampleCategory::VARIABLE);
+
+  metrics_.add(CPetBasicMetrics::Metric::VARIABLE_LOOKUPS);
+
   auto uname = CPetBasicUtil::toUpper(name);
 
   auto var = expr_->getVariable(uname);
@@ -5436,7 +7137,7 @@ CExprValuePtr
 CPetBasic::
 getVariableValue(const std::string &name) const
 {
-  return getVariable(name)->value();
+  return getVariable(name)->getValue();
 }
 
 bool
@@ -5477,7 +7178,7 @@ setVariableValue(const std::string &name, const CExprValuePtr &value)
   else {
     var->setValue(value1);
 
-    notifyVariablesChanged();
+    queueVariableChanged(uname);
   }
 
   return true;
@@ -5501,7 +7202,9 @@ dimVariable(const std::string &name, const Inds &inds)
   auto pv = th->arrayVariables_.find(uname);
   assert(pv != th->arrayVariables_.end());
 
-  return (*pv).second.resize(inds);
+  (*pv).second.resize(inds);
+
+  queueArrayVariableChanged(uname);
 }
 
 bool
@@ -5534,7 +7237,7 @@ addArrayVariable(const std::string &uname, int ndim)
 
   arrayVariables_[uname] = arrayData;
 
-  notifyVariablesChanged();
+  queueArrayVariableChanged(uname);
 }
 
 CExprValuePtr
@@ -5545,6 +7248,8 @@ getVariableValue(const std::string &name, const Inds &inds)
 
   //std::cerr << "getVariableValue: " << uname << " "; printInds(inds); std::cerr << "\n";
 
+  metrics_.add(CPetBasicMetrics::Metric::VARIABLE_LOOKUPS);
+
   auto *th = const_cast<CPetBasic *>(this);
 
   if (! hasArrayVariable(uname))
@@ -5579,7 +7284,7 @@ setVariableValue(const std::string &name, const Inds &inds, const CExprValuePtr
 
   bool rc = (*pv).second.setValue(inds, value1);
 
-  notifyVariablesChanged();
+  queueArrayVariableChanged(uname);
 
   return rc;
 }
@@ -5602,6 +7307,32 @@ getVariableNames(std::vector<std::string> &names, std::vector<std::string> &arra
     arrayNames.push_back(pa.first);
 }
 
+bool
+CPetBasic::
+getArrayDims(const std::string &name, Inds &dims) const
+{
+  auto pv = arrayVariables_.find(CPetBasicUtil::toUpper(name));
+
+  if (pv == arrayVariables_.end())
+    return false;
+
+  dims = (*pv).second.dims();
+
+  return true;
+}
+
+CExprValuePtr
+CPetBasic::
+getArrayValue(const std::string &name, uint i) const
+{
+  auto pv = arrayVariables_.find(CPetBasicUtil::toUpper(name));
+
+  if (pv == arrayVariables_.end())
+    return CExprValuePtr();
+
+  return (*pv).second.valueAt(i);
+}
+
 //---
 
 void
@@ -5677,283 +7408,235 @@ errorMsg(const std::string &msg) const
 
 //---
 
-CPetsciChar
-CPetBasic::
-drawCharToPet(const CPetDrawChar &drawChar)
-{
-  CPetsciChar pet;
-
-  if (drawChar.utf() > 0) {
-    auto utfToPet = [](ulong utf1) -> uchar {
-      switch (utf1) {
-        case 0x1fb79: return 64 ; // horizontal mid line
-        case 0x2660 : return 65 ; // spades suit
-        case 0x1fb72: return 66 ; // vertical line 1
-        case 0x1fb78: return 67 ; // horizontal line 1
-        case 0x1fb77: return 68 ; // horizontal line 2
-        case 0x1fb76: return 69 ; // horizontal line 3
-        case 0x1fb7a: return 70 ; // horizontal line 4
-        case 0x1fb71: return 71 ; // vertical line 2
-        case 0x1fb74: return 72 ; // vertical line 3
-        case 0x256e : return 73 ; // round corner ll
-        case 0x2570 : return 74 ; // round corner ur
-        case 0x256f : return 75 ; // round corner ul
-        case 0x1fb7c: return 76 ; // square corner ll
-        case 0x2572 : return 77 ; // diagonal tl->br
-        case 0x2571 : return 78 ; // diagonal bl->tr
-        case 0x1fb7d: return 79 ; // square corner tl
-        case 0x1fb7e: return 80 ; // square corner tr
-        case 0x25cf : return 81 ; // white filled circle, black square
-        case 0x1fb7b: return 82 ; // horizontal line 5
-        case 0x2665 : return 83 ; // hearts suit
-        case 0x1fb70: return 84 ; // vertical line 4
-        case 0x256d : return 85 ; // round corner lr
-        case 0x2573 : return 86 ; // cross
-        case 0x25cb : return 87 ; // white stroked circle, black square
-        case 0x2663 : return 88 ; // clubs suit
-        case 0x1fb75: return 89 ; // vertical line 5
-        case 0x2666 : return 90 ; // diamonds suit
-        case 0x253c : return 91 ; // plus
-        case 0x1fb8c: return 92 ; // hash fill left half
-        case 0x2502 : return 93 ; // vertical line 5
-        case 0x03c0 : return 94 ; // pi
-        case 0x25e5 : return 95 ; // filled tr triangle
-        case 0x00a0 : return 96 ; // space
-        case 0x258c : return 97 ; // filled left side
-        case 0x2584 : return 98 ; // filled bottom side
-        case 0x2594 : return 99 ; // filled top side
-        case 0x2581 : return 100; // horizontal line bottom
-        case 0x258f : return 101; // vertical line left
-        case 0x2592 : return 102; // hash fill
-        case 0x2595 : return 103; // line top and right
-        case 0x1fb8f: return 104; // hash fill bottom half
-        case 0x25e4 : return 105; // filled tl triangle
-        case 0x1fb87: return 106; // thick line right
-        case 0x251c : return 107; // vertical line mid and to right
-        case 0x2597 : return 108; // filled br quarter
-        case 0x2514 : return 109; // stroked tr quarter
-        case 0x2510 : return 110; // stroked bl quarter
-        case 0x2582 : return 111; // thick line bottom
-        case 0x250c : return 112; // stroked br quarter
-        case 0x2534 : return 113; // horizontal line mid and to top
-        case 0x252c : return 114; // horizontal line mid and to bottom
-        case 0x2524 : return 115; // vertical line mid and to left
-        case 0x258e : return 116; // thick line left
-        case 0x258d : return 117; // double thick line left
-        case 0x1fb88: return 118; // double thick line right
-        case 0x1fb82: return 119; // double thick line top
-        case 0x1fb83: return 120; // triple thick line top
-        case 0x2583 : return 121; // quadruple thick line bottom
-        case 0x1fb7f: return 122; // stroked br quarter
-        case 0x2596 : return 123; // filled bl quarter
-        case 0x259d : return 124; // filled tr quarter
-        case 0x2518 : return 125; // stroked tl quarter
-        case 0x2598 : return 126; // filled tl quarter
-        case 0x259a : return 127; // filled tl and br quarter
-        default     : return 32;
-      }
-    };
+namespace {
+
+// PETSCII graphic characters (64-127) as utf-8 code points
+constexpr ulong petGraphicUtf[64] = {
+  0x1fb79,  //  64 : horizontal mid line
+  0x2660,   //  65 : spades suit
+  0x1fb72,  //  66 : vertical line 1
+  0x1fb78,  //  67 : horizontal line 1
+  0x1fb77,  //  68 : horizontal line 2
+  0x1fb76,  //  69 : horizontal line 3
+  0x1fb7a,  //  70 : horizontal line 4
+  0x1fb71,  //  71 : vertical line 2
+  0x1fb74,  //  72 : vertical line 3
+  0x256e,   //  73 : round corner ll
+  0x2570,   //  74 : round corner ur
+  0x256f,   //  75 : round corner ul
+  0x1fb7c,  //  76 : square corner ll
+  0x2572,   //  77 : diagonal tl->br
+  0x2571,   //  78 : diagonal bl->tr
+  0x1fb7d,  //  79 : square corner tl
+  0x1fb7e,  //  80 : square corner tr
+  0x25cf,   //  81 : white filled circle, black square
+  0x1fb7b,  //  82 : horizontal line 5
+  0x2665,   //  83 : hearts suit
+  0x1fb70,  //  84 : vertical line 4
+  0x256d,   //  85 : round corner lr
+  0x2573,   //  86 : cross
+  0x25cb,   //  87 : white stroked circle, black square
+  0x2663,   //  88 : clubs suit
+  0x1fb75,  //  89 : vertical line 5
+  0x2666,   //  90 : diamonds suit
+  0x253c,   //  91 : plus
+  0x1fb8c,  //  92 : hash fill left half
+  0x2502,   //  93 : vertical line 5
+  0x03c0,   //  94 : pi
+  0x25e5,   //  95 : filled tr triangle
+  0x00a0,   //  96 : space
+  0x258c,   //  97 : filled left side
+  0x2584,   //  98 : filled bottom side
+  0x2594,   //  99 : filled top side
+  0x2581,   // 100 : horizontal line bottom
+  0x258f,   // 101 : vertical line left
+  0x2592,   // 102 : hash fill
+  0x2595,   // 103 : line top and right
+  0x1fb8f,  // 104 : hash fill bottom half
+  0x25e4,   // 105 : filled tl triangle
+  0x1fb87,  // 106 : thick line right
+  0x251c,   // 107 : vertical line mid and to right
+  0x2597,   // 108 : filled br quarter
+  0x2514,   // 109 : stroked tr quarter
+  0x2510,   // 110 : stroked bl quarter
+  0x2582,   // 111 : thick line bottom
+  0x250c,   // 112 : stroked br quarter
+  0x2534,   // 113 : horizontal line mid and to top
+  0x252c,   // 114 : horizontal line mid and to bottom
+  0x2524,   // 115 : vertical line mid and to left
+  0x258e,   // 116 : thick line left
+  0x258d,   // 117 : double thick line left
+  0x1fb88,  // 118 : double thick line right
+  0x1fb82,  // 119 : double thick line top
+  0x1fb83,  // 120 : triple thick line top
+  0x2583,   // 121 : quadruple thick line bottom
+  0x1fb7f,  // 122 : stroked br quarter
+  0x2596,   // 123 : filled bl quarter
+  0x259d,   // 124 : filled tr quarter
+  0x2518,   // 125 : stroked tl quarter
+  0x2598,   // 126 : filled tl quarter
+  0x259a,   // 127 : filled tl and br quarter
+};
 
-    pet = CPetsciChar(utfToPet(drawChar.utf()));
-  }
-  else {
-    auto asciiToPet = [](uchar ascii1) -> uchar {
-      switch (ascii1) {
-        case '@': return 0;
-        case 'A': case 'B': case 'C': case 'D': case 'E': case 'F': case 'G': case 'H':
-        case 'I': case 'J': case 'K': case 'L': case 'M': case 'N': case 'O': case 'P':
-        case 'Q': case 'R': case 'S': case 'T': case 'U': case 'V': case 'W': case 'X':
-        case 'Y': case 'Z':
-          return (ascii1 - 'A' + 1);
-        case 'a': case 'b': case 'c': case 'd': case 'e': case 'f': case 'g': case 'h':
-        case 'i': case 'j': case 'k': case 'l': case 'm': case 'n': case 'o': case 'p':
-        case 'q': case 'r': case 's': case 't': case 'u': case 'v': case 'w': case 'x':
-        case 'y': case 'z':
-          return (ascii1 - 'a' + 1);
-        case '[': return 27;
-        case '\\': return 28;
-        case ']': return 29;
-        case '^': return 30; // up arrow
-        case '~': return 31; // back arrow
-        case ' ': return 32;
-        case '!': return 33;
-        case '"': return 34;
-        case '#': return 35;
-        case '$': return 36;
-        case '%': return 37;
-        case '&': return 38;
-        case '\'': return 39;
-        case '(': return 40;
-        case ')': return 41;
-        case '*': return 42;
-        case '+': return 43;
-        case ',': return 44;
-        case '-': return 45;
-        case '.': return 46;
-        case '/': return 47;
-        case '0': case '1': case '2': case '3': case '4':
-        case '5': case '6': case '7': case '8': case '9':
-          return (ascii1 - '0' + 48);
-        case ':': return 58;
-        case ';': return 59;
-        case '<': return 60;
-        case '=': return 61;
-        case '>': return 62;
-        case '?': return 63;
-        // 64-127 : graphic characters
-        default: return 32;
-      }
-    };
+// map ascii char to PETSCII (screen code)
+constexpr uchar asciiToPet(uchar ascii) {
+  if (ascii >= 'A' && ascii <= 'Z') return uchar(ascii - 'A' + 1);
+  if (ascii >= 'a' && ascii <= 'z') return uchar(ascii - 'a' + 1);
+  if (ascii >= '0' && ascii <= '9') return uchar(ascii - '0' + 48);
+
+  switch (ascii) {
+    case '@' : return 0;
+    case '[' : return 27;
+    case '\\': return 28;
+    case ']' : return 29;
+    case '^' : return 30; // up arrow
+    case '~' : return 31; // back arrow
+    case ' ' : case '!' : case '"' : case '#' : case '$' : case '%' : case '&' : case '\'':
+    case '(' : case ')' : case '*' : case '+' : case ',' : case '-' : case '.' : case '/' :
+      return ascii; // 32-47
+    case ':' : case ';' : case '<' : case '=' : case '>' : case '?' :
+      return ascii; // 58-63
+    // 64-127 : graphic characters
+    default: return 32;
+  }
+}
+
+// map unreversed PETSCII (0-127) to draw char
+constexpr CPetDrawChar petToDrawChar1(uchar pet) {
+  CPetDrawChar drawChar;
 
-    pet = CPetsciChar(asciiToPet(drawChar.c()));
+  // 0-63 normal characters
+  if      (pet < 64) {
+    if      (pet == 0)
+      drawChar.setC('@');
+    else if (pet <= 26)
+      drawChar.setC(uchar('A' + pet - 1));
+    else if (pet == 27)
+      drawChar.setC('[');
+    else if (pet == 28)
+      drawChar.setC('\\');
+    else if (pet == 29)
+      drawChar.setC(']');
+    else if (pet == 30)
+      drawChar.setC('^'); // up arrow
+    else if (pet == 31)
+      drawChar.setC('~'); // left arrow
+    else
+      drawChar.setC(pet); // 32-63 same as ascii
   }
+  // 64-127 : graphic characters
+  else if (pet < 128)
+    drawChar.setUtf(petGraphicUtf[pet - 64]);
 
-  if (drawChar.isReverse())
-    pet.reverse();
+  return drawChar;
+}
 
-  return pet;
+template<typename T, typename F>
+constexpr std::array<T, 256> makeTable(F f) {
+  std::array<T, 256> table {};
+
+  for (uint i = 0; i < 256; ++i)
+    table[i] = f(uchar(i));
+
+  return table;
 }
 
-CPetDrawChar
-CPetBasic::
-petToDrawChar(const CPetsciChar &pet)
-{
-  CPetsciChar pet1 = pet;
+// ascii char to PETSCII
+constexpr auto asciiPetTable = makeTable<uchar>(asciiToPet);
 
-  CPetDrawChar drawChar;
+// PETSCII (with reverse) to draw char
+constexpr auto petDrawCharTable = makeTable<CPetDrawChar>([](uchar pet) {
+  auto drawChar = petToDrawChar1(uchar(pet & 0x7f));
+  drawChar.setReverse(pet >= 128);
+  return drawChar;
+});
 
-  if (pet1.isReversed()) {
-    pet1.unreverse();
+// code point to PETSCII lookup sorted by code point
+struct UtfPet {
+  ulong utf { 0 };
+  uchar pet { 0 };
+};
+
+using UtfPetTable = std::array<UtfPet, 64>;
+
+constexpr UtfPetTable makeUtfPetTable() {
+  UtfPetTable table {};
+
+  for (uint i = 0; i < 64; ++i) {
+    UtfPet utfPet { petGraphicUtf[i], uchar(64 + i) };
 
-    drawChar.setReverse(true);
+    // insertion sort
+    auto j = i;
+
+    for ( ; j > 0 && table[j - 1].utf > utfPet.utf; --j)
+      table[j] = table[j - 1];
+
+    table[j] = utfPet;
   }
 
-  auto setC = [&](uchar c) {
-    drawChar.setC(c);
-    return drawChar;
-  };
+  return table;
+}
 
-  // A-Z
-  if (pet1.c() >= 1 && pet1.c() <= 26)
-    return setC(uchar('A' + pet1.c() - 1));
+constexpr auto utfPetTable = makeUtfPetTable();
 
-  // 0-9
-  if (pet1.c() >= 48 && pet1.c() <= 57)
-    return setC('0' + pet1.c() - 48);
+// check all PETSCII codes map to a draw char and back
+constexpr bool checkPetRoundTrip() {
+  for (uint i = 0; i < 256; ++i) {
+    const auto &drawChar = petDrawCharTable[i];
 
-  // 0-63 normal characters
-  if (pet1.c() < 64) {
-    switch (pet1.c()) {
-      case 0 : return setC('@');
-      // A-Z (1-26)
-      case 27: return setC('[');
-      case 28: return setC('\\');
-      case 29: return setC(']');
-      case 30: return setC('^'); // up arrow
-      case 31: return setC('~'); // left arrow
-      case 32: return setC(' ');
-      case 33: return setC('!');
-      case 34: return setC('"');
-      case 35: return setC('#');
-      case 36: return setC('$');
-      case 37: return setC('%');
-      case 38: return setC('&');
-      case 39: return setC('\'');
-      case 40: return setC('(');
-      case 41: return setC(')');
-      case 42: return setC('*');
-      case 43: return setC('+');
-      case 44: return setC(',');
-      case 45: return setC('-');
-      case 46: return setC('.');
-      case 47: return setC('/');
-      // 0-9 (48-57)
-      case 58: return setC(':');
-      case 59: return setC(';');
-      case 60: return setC('<');
-      case 61: return setC('=');
-      case 62: return setC('>');
-      case 63: return setC('?');
+    uint pet = 32;
+
+    if (drawChar.utf() > 0) {
+      for (const auto &utfPet : utfPetTable)
+        if (utfPet.utf == drawChar.utf())
+          pet = utfPet.pet;
     }
+    else
+      pet = asciiPetTable[drawChar.c()];
+
+    if (drawChar.isReverse())
+      pet += 128;
+
+    if (pet != i)
+      return false;
   }
 
-  auto setUtf = [&](ulong utf) {
-    drawChar.setUtf(utf);
-    return drawChar;
-  };
+  return true;
+}
 
-  // 64-127 : graphic characters
-  switch (pet1.c()) {
-    case 64 : return setUtf(0x1fb79); // horizontal mid line
-    case 65 : return setUtf(0x2660 ); // spades suit
-    case 66 : return setUtf(0x1fb72); // vertical line 1
-    case 67 : return setUtf(0x1fb78); // horizontal line 1
-    case 68 : return setUtf(0x1fb77); // horizontal line 2
-    case 69 : return setUtf(0x1fb76); // horizontal line 3
-    case 70 : return setUtf(0x1fb7a); // horizontal line 4
-    case 71 : return setUtf(0x1fb71); // vertical line 2
-    case 72 : return setUtf(0x1fb74); // vertical line 3
-    case 73 : return setUtf(0x256e ); // round corner ll
-    case 74 : return setUtf(0x2570 ); // round corner ur
-    case 75 : return setUtf(0x256f ); // round corner ul
-    case 76 : return setUtf(0x1fb7c); // square corner ll
-    case 77 : return setUtf(0x2572 ); // diagonal tl->br
-    case 78 : return setUtf(0x2571 ); // diagonal bl->tr
-    case 79 : return setUtf(0x1fb7d); // square corner tl
-    case 80 : return setUtf(0x1fb7e); // square corner tr
-    case 81 : return setUtf(0x25cf ); // white filled circle, black square
-    case 82 : return setUtf(0x1fb7b); // horizontal line 5
-    case 83 : return setUtf(0x2665 ); // hearts suit
-    case 84 : return setUtf(0x1fb70); // vertical line 4
-    case 85 : return setUtf(0x256d ); // round corner lr
-    case 86 : return setUtf(0x2573 ); // cross
-    case 87 : return setUtf(0x25cb ); // white stroked circle, black square
-    case 88 : return setUtf(0x2663 ); // clubs suit
-    case 89 : return setUtf(0x1fb75); // vertical line 5
-    case 90 : return setUtf(0x2666 ); // diamonds suit
-    case 91 : return setUtf(0x253c ); // plus
-    case 92 : return setUtf(0x1fb8c); // hash fill left half
-    case 93 : return setUtf(0x2502 ); // vertical line 5
-    case 94 : return setUtf(0x03c0 ); // pi
-    case 95 : return setUtf(0x25e5 ); // filled tr triangle
-    case 96 : return setUtf(0x00a0 ); // space
-    case 97 : return setUtf(0x258c ); // filled left side
-    case 98 : return setUtf(0x2584 ); // filled bottom side
-    case 99 : return setUtf(0x2594 ); // filled top side
-    case 100: return setUtf(0x2581 ); // horizontal line bottom
-    case 101: return setUtf(0x258f ); // vertical line left
-    case 102: return setUtf(0x2592 ); // hash fill
-    case 103: return setUtf(0x2595 ); // line top and right
-    case 104: return setUtf(0x1fb8f); // hash fill bottom half
-    case 105: return setUtf(0x25e4 ); // filled tl triangle
-    case 106: return setUtf(0x1fb87); // thick line right
-    case 107: return setUtf(0x251c ); // vertical line mid and to right
-    case 108: return setUtf(0x2597 ); // filled br quarter
-    case 109: return setUtf(0x2514 ); // stroked tr quarter
-    case 110: return setUtf(0x2510 ); // stroked bl quarter
-    case 111: return setUtf(0x2582 ); // thick line bottom
-    case 112: return setUtf(0x250c ); // stroked br quarter
-    case 113: return setUtf(0x2534 ); // horizontal line mid and to top
-    case 114: return setUtf(0x252c ); // horizontal line mid and to bottom
-    case 115: return setUtf(0x2524 ); // vertical line mid and to left
-    case 116: return setUtf(0x258e ); // thick line left
-    case 117: return setUtf(0x258d ); // double thick line left
-    case 118: return setUtf(0x1fb88); // double thick line right
-    case 119: return setUtf(0x1fb82); // double thick line top
-    case 120: return setUtf(0x1fb83); // triple thick line top
-    case 121: return setUtf(0x2583 ); // quadruple thick line bottom
-    case 122: return setUtf(0x1fb7f); // stroked br quarter
-    case 123: return setUtf(0x2596 ); // filled bl quarter
-    case 124: return setUtf(0x259d ); // filled tr quarter
-    case 125: return setUtf(0x2518 ); // stroked tl quarter
-    case 126: return setUtf(0x2598 ); // filled tl quarter
-    case 127: return setUtf(0x259a ); // filled tl and br quarter
-  }
-
-  // TODO ?
-  assert(false);
+static_assert(checkPetRoundTrip(), "PETSCII tables are inconsistent");
 
-  return drawChar;
+uchar utfToPet(ulong utf) {
+  auto p = std::lower_bound(utfPetTable.begin(), utfPetTable.end(), utf,
+    [](const UtfPet &utfPet, ulong utf1) { return utfPet.utf < utf1; });
+
+  if (p == utfPetTable.end() || (*p).utf != utf)
+    return 32;
+
+  return (*p).pet;
+}
+
+}
+
+CPetsciChar
+CPetBasic::
+drawCharToPet(const CPetDrawChar &drawChar)
+{
+  auto utf = drawChar.utf();
+
+  auto c = (utf > 0 ? utfToPet(utf) : asciiPetTable[drawChar.c()]);
+
+  if (drawChar.isReverse())
+    c += 128;
+
+  return CPetsciChar(c);
+}
+
+CPetDrawChar
+CPetBasic::
+petToDrawChar(const CPetsciChar &pet)
+{
+  return petDrawCharTable[pet.c()];
 }
 
 //---
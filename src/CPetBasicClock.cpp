@@ -0,0 +1,131 @@
+#include <CPetBasicClock.h>
+#include <CPetBasicUtil.h>
+
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+
+CPetBasicClock::
+CPetBasicClock()
+{
+  reset();
+}
+
+void
+CPetBasicClock::
+reset()
+{
+  baseUSecs_      = CPetBasicUtil::currentUSecs();
+  offsetJiffies_  = 0;
+  virtualUSecs_   = 0;
+  lastStatements_ = 0;
+}
+
+void
+CPetBasicClock::
+setVirtual(bool b, long statementUSecs)
+{
+  virtual_        = b;
+  statementUSecs_ = std::max(statementUSecs, 0L);
+
+  reset();
+}
+
+long
+CPetBasicClock::
+usecs(long statements) const
+{
+  if (! virtual_)
+    return CPetBasicUtil::currentUSecs() - baseUSecs_;
+
+  // advance by statements run since last read (count restarts if metrics reset)
+  auto n = statements - lastStatements_;
+
+  if (n < 0)
+    n = statements;
+
+  virtualUSecs_   += n*statementUSecs_;
+  lastStatements_  = statements;
+
+  return virtualUSecs_;
+}
+
+long
+CPetBasicClock::
+jiffies(long statements) const
+{
+  auto j = (usecs(statements)*jiffiesPerSec)/1000000 + offsetJiffies_;
+
+  j %= jiffiesPerDay;
+
+  if (j < 0)
+    j += jiffiesPerDay;
+
+  return j;
+}
+
+void
+CPetBasicClock::
+setJiffies(long jiffies, long statements)
+{
+  auto j = (usecs(statements)*jiffiesPerSec)/1000000;
+
+  offsetJiffies_ = jiffies - j;
+}
+
+std::string
+CPetBasicClock::
+timeString(long statements) const
+{
+  return jiffiesToString(jiffies(statements));
+}
+
+bool
+CPetBasicClock::
+setTimeString(const std::string &str, long statements)
+{
+  // HHMMSS
+  if (str.size() != 6)
+    return false;
+
+  for (auto c : str)
+    if (! isdigit(c))
+      return false;
+
+  auto field = [&](int i) { return (str[i] - '0')*10 + (str[i + 1] - '0'); };
+
+  auto h = field(0), m = field(2), s = field(4);
+
+  if (h >= 24 || m >= 60 || s >= 60)
+    return false;
+
+  setJiffies(((h*60 + m)*60 + s)*jiffiesPerSec, statements);
+
+  return true;
+}
+
+std::string
+CPetBasicClock::
+jiffiesToString(long jiffies)
+{
+  auto s = jiffies/jiffiesPerSec;
+
+  auto h = (s/3600) % 24;
+  auto m = (s/60) % 60;
+
+  s %= 60;
+
+  char buffer[16];
+
+  snprintf(buffer, sizeof(buffer), "%02ld%02ld%02ld", h, m, s);
+
+  return buffer;
+}
+
+void
+CPetBasicClock::
+addDelay(long usecs)
+{
+  if (virtual_ && usecs > 0)
+    virtualUSecs_ += usecs;
+}
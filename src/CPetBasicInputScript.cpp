@@ -0,0 +1,130 @@
+#include <CPetBasicInputScript.h>
+
+#include <cctype>
+#include <fstream>
+
+bool
+CPetBasicInputScript::
+load(const std::string &fileName)
+{
+  std::ifstream fs(fileName);
+
+  if (! fs) {
+    errorMsg_ = "Failed to open '" + fileName + "'";
+    return false;
+  }
+
+  events_.clear();
+
+  rewind();
+
+  std::string line;
+
+  uint lineNum = 0;
+
+  while (std::getline(fs, line)) {
+    ++lineNum;
+
+    if (! addLine(line)) {
+      errorMsg_ += " @" + std::to_string(lineNum);
+      return false;
+    }
+  }
+
+  return true;
+}
+
+bool
+CPetBasicInputScript::
+addLine(const std::string &line)
+{
+  auto len = line.size();
+
+  // skip trailing CR (DOS line endings)
+  if (len > 0 && line[len - 1] == '\r')
+    --len;
+
+  size_t pos = 0;
+
+  while (pos < len && isspace(line[pos]))
+    ++pos;
+
+  if (pos >= len || line[pos] == '#')
+    return true;
+
+  Event event;
+
+  // optional statement delay
+  if (line[pos] == '+') {
+    ++pos;
+
+    if (pos >= len || ! isdigit(line[pos])) {
+      errorMsg_ = "Invalid delay";
+      return false;
+    }
+
+    while (pos < len && isdigit(line[pos]))
+      event.delay = 10*event.delay + (line[pos++] - '0');
+
+    // single space separates delay and keys
+    if (pos < len && line[pos] == ' ')
+      ++pos;
+  }
+
+  while (pos < len) {
+    auto c = line[pos++];
+
+    if (c != '\\' || pos >= len) {
+      event.keys += c;
+      continue;
+    }
+
+    c = line[pos++];
+
+    if      (c == 'r')
+      event.keys += '\r';
+    else if (c == 'x') {
+      int n = 0, nd = 0;
+
+      while (nd < 2 && pos < len && isxdigit(line[pos])) {
+        auto c1 = char(tolower(line[pos++]));
+
+        n = 16*n + (isdigit(c1) ? c1 - '0' : c1 - 'a' + 10);
+
+        ++nd;
+      }
+
+      if (nd == 0) {
+        errorMsg_ = "Invalid \\x escape";
+        return false;
+      }
+
+      event.keys += char(n);
+    }
+    else
+      event.keys += c;
+  }
+
+  events_.push_back(event);
+
+  return true;
+}
+
+bool
+CPetBasicInputScript::
+nextKeys(long statements, bool idle, std::string &keys)
+{
+  if (isDone())
+    return false;
+
+  const auto &event = events_[pos_];
+
+  if (! idle && statements < event.delay)
+    return false;
+
+  keys = event.keys;
+
+  ++pos_;
+
+  return true;
+}
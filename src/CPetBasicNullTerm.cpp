@@ -0,0 +1,197 @@
+#include <CPetBasicNullTerm.h>
+#include <CPetBasic.h>
+#include <CUtf8.h>
+
+#include <algorithm>
+#include <fstream>
+
+CPetBasicNullTerm::
+CPetBasicNullTerm(CPetBasic *basic) :
+ CPetBasicTerm(basic)
+{
+}
+
+CPetBasicNullTerm::
+~CPetBasicNullTerm()
+{
+}
+
+void
+CPetBasicNullTerm::
+resize(uint nr, uint nc)
+{
+  CPetBasicTerm::resize(nr, nc);
+
+  frameBuffer_.resize(nc*cellPixels, nr*cellPixels);
+
+  plotWidth_  = 0;
+  plotHeight_ = 0;
+}
+
+bool
+CPetBasicNullTerm::
+plotOutside(long x, long y, long color)
+{
+  if (x < 0 || y < 0 || x >= long(maxPlotSize) || y >= long(maxPlotSize))
+    return false;
+
+  plotWidth_  = std::max(plotWidth_ , uint(x + 1));
+  plotHeight_ = std::max(plotHeight_, uint(y + 1));
+
+  // grow by at least double so PLOTs along an edge don't copy buffer each time
+  auto grow = [](uint size, uint needed) {
+    return (needed > size ? std::min(std::max(needed, 2*size), maxPlotSize) : size);
+  };
+
+  frameBuffer_.grow(grow(frameBuffer_.width (), plotWidth_ ),
+                    grow(frameBuffer_.height(), plotHeight_));
+
+  return plot(x, y, color);
+}
+
+//---
+
+void
+CPetBasicNullTerm::
+loop()
+{
+  // no interactive input
+}
+
+std::string
+CPetBasicNullTerm::
+readString(const std::string &) const
+{
+  // line from keyboard buffer (up to RETURN)
+  std::string str;
+
+  (void) readKeyLine(str);
+
+  return str;
+}
+
+char
+CPetBasicNullTerm::
+readChar() const
+{
+  uchar c;
+
+  if (! basic_->popKey(c))
+    return '\0';
+
+  return char(toupper(c));
+}
+
+bool
+CPetBasicNullTerm::
+waitKey(long)
+{
+  // nothing can push keys while running headless so don't wait
+  return basic_->hasKey();
+}
+
+//---
+
+void
+CPetBasicNullTerm::
+redraw()
+{
+}
+
+void
+CPetBasicNullTerm::
+delay(long)
+{
+}
+
+//---
+
+std::string
+CPetBasicNullTerm::
+screenText() const
+{
+  std::string text;
+
+  for (uint r = 0; r < nr_; ++r) {
+    std::string line;
+
+    for (uint c = 0; c < nc_; ++c) {
+      auto drawChar = getChar(r, c);
+
+      if      (drawChar.utf())
+        CUtf8::append(line, drawChar.utf());
+      else if (drawChar.isSet())
+        line += char(drawChar.c());
+      else
+        line += ' ';
+    }
+
+    auto pos = line.find_last_not_of(' ');
+
+    line.resize(pos != std::string::npos ? pos + 1 : 0);
+
+    text += line + "\n";
+  }
+
+  return text;
+}
+
+bool
+CPetBasicNullTerm::
+writeScreen(const std::string &fileName) const
+{
+  if (fileName == "-") {
+    std::cout << screenText() << std::flush;
+    return true;
+  }
+
+  std::ofstream os(fileName);
+  if (! os) return false;
+
+  os << screenText();
+
+  return bool(os);
+}
+
+uint
+CPetBasicNullTerm::
+frameWidth() const
+{
+  return std::min(std::max(nc_*cellPixels, plotWidth_), frameBuffer_.width());
+}
+
+uint
+CPetBasicNullTerm::
+frameHeight() const
+{
+  return std::min(std::max(nr_*cellPixels, plotHeight_), frameBuffer_.height());
+}
+
+bool
+CPetBasicNullTerm::
+writeFrameBuffer(const std::string &fileName) const
+{
+  std::ofstream os(fileName, std::ios::binary);
+  if (! os) return false;
+
+  auto w = frameWidth ();
+  auto h = frameHeight();
+
+  os << "P6\n" << w << " " << h << "\n255\n";
+
+  std::string row(size_t(w)*3, '\0');
+
+  for (uint y = 0; y < h; ++y) {
+    const auto *pixels = frameBuffer_.scanLine(y);
+
+    for (uint x = 0; x < w; ++x) {
+      auto c = char(pixels[x]);
+
+      row[3*x] = row[3*x + 1] = row[3*x + 2] = c;
+    }
+
+    os.write(row.data(), std::streamsize(row.size()));
+  }
+
+  return bool(os);
+}
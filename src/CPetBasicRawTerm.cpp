@@ -45,11 +45,11 @@ setRaw(bool b)
       COSPty::set_raw(STDOUT_FILENO, ios_);
 
       // alt screen ?
-      COSRead::write(STDOUT_FILENO, CEscape::DECSET(1049));
+      writeOut(CEscape::DECSET(1049));
 
       // show/blink cursor (hide ? DECRST)
-      COSRead::write(STDOUT_FILENO, CEscape::DECSET(25));
-      COSRead::write(STDOUT_FILENO, CEscape::DECSET(12));
+      writeOut(CEscape::DECSET(25));
+      writeOut(CEscape::DECSET(12));
 
       (void) CEscape::getWindowCharSize(&screenRows_, &screenCols_);
 
@@ -63,13 +63,13 @@ setRaw(bool b)
         return;
       }
 
-      COSRead::write(STDOUT_FILENO, CEscape::DECRST(1049));
+      writeOut(CEscape::DECRST(1049));
 
       // show/blink cursor
-      COSRead::write(STDOUT_FILENO, CEscape::DECSET(25));
-      COSRead::write(STDOUT_FILENO, CEscape::DECSET(12));
+      writeOut(CEscape::DECSET(25));
+      writeOut(CEscape::DECSET(12));
 
-      COSRead::write(STDOUT_FILENO, CEscape::SGR(0));
+      writeOut(CEscape::SGR(0));
 
       delete ios_;
 
@@ -98,6 +98,8 @@ loop()
   while (true) {
     state_ = State::LOOP;
 
+    flush();
+
     if (! COSRead::wait_read(STDIN_FILENO, 0, 100)) continue;
 
     std::string buffer;
@@ -160,9 +162,19 @@ readString(const std::string &prompt) const
 
   auto *th = const_cast<CPetBasicRawTerm *>(this);
 
+  // keys already typed (pushed or scripted)
+  std::string line;
+
+  if (readKeyLine(line)) {
+    basic_->printString(line + "\n");
+    return line;
+  }
+
   while (true) {
     th->state_ = State::READ_STRING;
 
+    th->flush();
+
     if (! COSRead::wait_read(STDIN_FILENO, 0, 100)) continue;
 
     std::string buffer;
@@ -222,42 +234,17 @@ readChar() const
 
   th->state_ = State::READ_CHAR;
 
-  char c = '\0';
+  th->flush();
 
-  for (uint i = 0; i < 10; ++i) {
-    // read pending key input
-    if (! COSRead::wait_read(STDIN_FILENO, 0, 100)) {
-      COSTimer::milli_sleep(uint(100));
-      continue;
-    }
-
-    std::string buffer;
-
-    if (! COSRead::read(STDIN_FILENO, buffer)) {
-      COSTimer::milli_sleep(uint(100));
-      continue;
-    }
-
-    uint len = uint(buffer.size());
-    if (len == 0) {
-      COSTimer::milli_sleep(uint(100));
-      continue;
-    }
-
-    //---
-
-    // add to buffer
-    th->inputBuffer_ += buffer;
-
-    break;
-  }
+  // move pending key input to keyboard buffer (no wait)
+  th->pollKeys();
 
   // pull char from buffer if any
-  if (th->inputBuffer_.size()) {
-    c = th->inputBuffer_[0];
+  uchar c1 = '\0';
 
-    th->inputBuffer_ = th->inputBuffer_.substr(1);
-  }
+  (void) basic_->popKey(c1);
+
+  auto c = char(c1);
 
   th->state_ = State::NONE;
 
@@ -273,6 +260,43 @@ readChar() const
   return c;
 }
 
+bool
+CPetBasicRawTerm::
+waitKey(long usecs)
+{
+  if (! isRaw())
+    return CPetBasicTerm::waitKey(usecs);
+
+  if (basic_->hasKey())
+    return true;
+
+  // wait for stdin input
+  if (COSRead::wait_read(STDIN_FILENO, int(usecs/1000000), int(usecs % 1000000)))
+    pollKeys();
+
+  return basic_->hasKey();
+}
+
+void
+CPetBasicRawTerm::
+pollKeys()
+{
+  // left over chars from previous input
+  basic_->pushKeys(inputBuffer_);
+
+  inputBuffer_ = "";
+
+  // read all available key input (zero timeout)
+  while (COSRead::wait_read(STDIN_FILENO, 0, 0)) {
+    std::string buffer;
+
+    if (! COSRead::read(STDIN_FILENO, buffer) || buffer.empty())
+      break;
+
+    basic_->pushKeys(buffer);
+  }
+}
+
 //---
 
 void
@@ -282,7 +306,7 @@ moveTo(uint r, uint c)
   CPetBasicTerm::moveTo(r, c);
 
   if (isRaw())
-    COSRead::write(STDOUT_FILENO, CEscape::CUP(r_ + 1, c_ + 1));
+    writeOut(CEscape::CUP(r_ + 1, c_ + 1));
 }
 
 //---
@@ -294,7 +318,7 @@ clear()
   CPetBasicTerm::clear();
 
   if (isRaw())
-    COSRead::write(STDOUT_FILENO, CEscape::ED(2)); // all
+    writeOut(CEscape::ED(2)); // all
 }
 
 void
@@ -308,8 +332,11 @@ enter()
   if (row() >= int(numRows()))
     scrollUp();
 
-  if (! isRaw())
+  if (! isRaw()) {
     std::cout << "\n";
+
+    addBytesWritten(1);
+  }
 }
 
 void
@@ -322,7 +349,7 @@ cursorUp()
     --r_;
 
   if (isRaw())
-    COSRead::write(STDOUT_FILENO, CEscape::CUU());
+    writeOut(CEscape::CUU());
 }
 
 void
@@ -332,7 +359,7 @@ cursorDown(bool force)
   CPetBasicTerm::cursorDown(force);
 
   if (isRaw())
-    COSRead::write(STDOUT_FILENO, CEscape::CUD());
+    writeOut(CEscape::CUD());
 }
 
 void
@@ -342,7 +369,7 @@ cursorLeft()
   CPetBasicTerm::cursorLeft();
 
   if (isRaw())
-    COSRead::write(STDOUT_FILENO, CEscape::CUB());
+    writeOut(CEscape::CUB());
 }
 
 void
@@ -352,7 +379,7 @@ cursorRight(bool force)
   CPetBasicTerm::cursorRight(force);
 
   if (isRaw())
-    COSRead::write(STDOUT_FILENO, CEscape::CUF());
+    writeOut(CEscape::CUF());
 }
 
 void
@@ -362,7 +389,7 @@ cursorLeftFull()
   CPetBasicTerm::cursorLeftFull();
 
   if (isRaw())
-    COSRead::write(STDOUT_FILENO, CEscape::CHA());
+    writeOut(CEscape::CHA());
 }
 
 //---
@@ -375,12 +402,15 @@ drawChar(const uchar &c)
     return false;
 
   if (isRaw()) {
-    COSRead::write(STDOUT_FILENO, CEscape::CUP(r_ + 1, c_ + 1));
-    COSRead::write(STDOUT_FILENO, c);
+    writeOut(CEscape::CUP(r_ + 1, c_ + 1));
+    writeOut(c);
   }
-  else
+  else {
     std::cout << c;
 
+    addBytesWritten(1);
+  }
+
   return true;
 }
 
@@ -393,7 +423,7 @@ drawChar(const CPetDrawChar &drawChar)
   setChar(r_, c_, drawChar);
 
   if (isRaw())
-    COSRead::write(STDOUT_FILENO, CEscape::CUP(r_ + 1, c_ + 1));
+    writeOut(CEscape::CUP(r_ + 1, c_ + 1));
 
   if (drawChar.utf()) {
     std::string str;
@@ -401,15 +431,21 @@ drawChar(const CPetDrawChar &drawChar)
     CUtf8::append(str, drawChar.utf());
 
     if (isRaw())
-      COSRead::write(STDOUT_FILENO, str);
-    else
+      writeOut(str);
+    else {
       std::cout << str;
+
+      addBytesWritten(str.size());
+    }
   }
   else {
     if (isRaw())
-      COSRead::write(STDOUT_FILENO, drawChar.c());
-    else
+      writeOut(drawChar.c());
+    else {
       std::cout << drawChar.c();
+
+      addBytesWritten(1);
+    }
   }
 
   update();
@@ -421,45 +457,45 @@ drawChar(const CPetDrawChar &drawChar)
 
 void
 CPetBasicRawTerm::
-update()
+redraw()
 {
   if (isRaw()) {
     ++redrawCount_;
 
-    COSRead::write(STDOUT_FILENO, CEscape::ED(2)); // all
+    writeOut(CEscape::ED(2)); // all
 
     for (uint r = 0; r < nr_; ++r) {
       for (uint c = 0; c < nc_; ++c) {
         bool isCursor = (int(r) == r_ && int(c) == c_);
 
         if (isCursor)
-          COSRead::write(STDOUT_FILENO, CEscape::SGR(43));
+          writeOut(CEscape::SGR(43));
 
         auto drawChar = getChar(r, c);
 
         if ((drawChar.isSet() && drawChar.c() != ' ') || isCursor) {
-          COSRead::write(STDOUT_FILENO, CEscape::CUP(r + 1, c + 1));
+          writeOut(CEscape::CUP(r + 1, c + 1));
 
           if (drawChar.utf()) {
             std::string str;
 
             CUtf8::append(str, drawChar.utf());
 
-            COSRead::write(STDOUT_FILENO, str);
+            writeOut(str);
           }
           else {
-            COSRead::write(STDOUT_FILENO, drawChar.c());
+            writeOut(drawChar.c());
           }
         }
 
         if (isCursor)
-          COSRead::write(STDOUT_FILENO, CEscape::SGR(0));
+          writeOut(CEscape::SGR(0));
       }
     }
 
     //---
 
-    COSRead::write(STDOUT_FILENO, CEscape::CUP(screenRows_, 1));
+    writeOut(CEscape::CUP(screenRows_, 1));
 
     std::string status;
 
@@ -480,14 +516,36 @@ update()
 
     status += " STATE: " + stateStr();
 
-    COSRead::write(STDOUT_FILENO, status);
+    basic_->updateMetrics();
+
+    status += " " + basic_->metrics().statusString();
+
+    writeOut(status);
 
     //---
 
-    COSRead::write(STDOUT_FILENO, CEscape::CUP(r_ + 1, c_ + 1));
+    writeOut(CEscape::CUP(r_ + 1, c_ + 1));
   }
 }
 
+void
+CPetBasicRawTerm::
+writeOut(const std::string &str)
+{
+  COSRead::write(STDOUT_FILENO, str);
+
+  addBytesWritten(str.size());
+}
+
+void
+CPetBasicRawTerm::
+writeOut(char c)
+{
+  COSRead::write(STDOUT_FILENO, c);
+
+  addBytesWritten(1);
+}
+
 void
 CPetBasicRawTerm::
 delay(long t)
@@ -501,4 +559,6 @@ delay(long t)
 
     --delay_;
   }
+
+  flush();
 }
@@ -43,8 +43,12 @@ resize(uint nr, uint nc)
 
   chars_.resize(n);
 
+  topRow_ = 0;
+
   clear();
 
+  markAllDirty();
+
   update();
 }
 
@@ -96,6 +100,13 @@ std::string
 CPetBasicTerm::
 readString(const std::string &prompt) const
 {
+  const_cast<CPetBasicTerm *>(this)->flush();
+
+  std::string line;
+
+  if (readKeyLine(line))
+    return line;
+
   CReadLine readline;
 
   readline.setPrompt(prompt != "" ? prompt + " ? " : "? ");
@@ -107,6 +118,13 @@ char
 CPetBasicTerm::
 readChar() const
 {
+  const_cast<CPetBasicTerm *>(this)->flush();
+
+  uchar c;
+
+  if (basic_->popKey(c))
+    return char(toupper(c));
+
   CReadLine readline;
 
   readline.setPrompt("? ");
@@ -116,6 +134,13 @@ readChar() const
   return (line.size() ? line[0] : '\0');
 }
 
+bool
+CPetBasicTerm::
+waitKey(long usecs)
+{
+  return basic_->waitKey(usecs);
+}
+
 //---
 
 void
@@ -137,18 +162,62 @@ CPetDrawChar
 CPetBasicTerm::
 getChar(uint r, uint c) const
 {
-  auto i = encodeCharPos(r, c);
+  auto i = cellIndex(r, c);
 
   return chars_[i];
 }
 
+void
+CPetBasicTerm::
+getScreen(Screen &screen) const
+{
+  screen.nr = nr_;
+  screen.nc = nc_;
+  screen.r  = r_;
+  screen.c  = c_;
+
+  screen.dirty = dirtyRect_;
+
+  // copy changed framebuffer rows
+  screen.pw = frameBuffer_.width ();
+  screen.ph = frameBuffer_.height();
+
+  if (frameBuffer_.isDirty()) {
+    screen.py1 = frameBuffer_.dirtyRow1();
+    screen.py2 = frameBuffer_.dirtyRow2();
+
+    screen.pixels.resize(size_t(screen.py2 - screen.py1 + 1)*screen.pw);
+
+    for (int y = screen.py1; y <= screen.py2; ++y)
+      std::copy(frameBuffer_.scanLine(y), frameBuffer_.scanLine(y) + screen.pw,
+                &screen.pixels[size_t(y - screen.py1)*screen.pw]);
+  }
+  else {
+    screen.py1 = screen.py2 = -1;
+
+    screen.pixels.clear();
+  }
+
+  screen.chars.resize(nr_*nc_);
+
+  // unroll ring buffer so rows are in display order
+  auto n1 = (nr_ - topRow_)*nc_;
+
+  std::copy(chars_.begin() + topRow_*nc_, chars_.end(), screen.chars.begin());
+  std::copy(chars_.begin(), chars_.begin() + topRow_*nc_, screen.chars.begin() + n1);
+}
+
 void
 CPetBasicTerm::
 setChar(uint r, uint c, const CPetDrawChar &drawChar)
 {
-  auto i = encodeCharPos(r, c);
+  auto i = cellIndex(r, c);
 
-  chars_[i] = drawChar;
+  if (chars_[i] != drawChar) {
+    chars_[i] = drawChar;
+
+    markDirty(r, c);
+  }
 
   update();
 }
@@ -161,13 +230,12 @@ clear()
 {
   home();
 
-  for (uint r = 0; r < nr_; ++r) {
-    for (uint c = 0; c < nc_; ++c) {
-      auto i = encodeCharPos(r, c);
+  topRow_ = 0;
 
-      chars_[i] = CPetDrawChar(' ');
-    }
-  }
+  for (auto &drawChar : chars_)
+    drawChar = CPetDrawChar(' ');
+
+  markAllDirty();
 
   update();
 }
@@ -183,8 +251,11 @@ enter()
   if (row() >= int(numRows()))
     scrollUp();
 
-  if (isTty())
+  if (isTty()) {
     std::cout << "\n";
+
+    addBytesWritten(1);
+  }
 }
 
 void
@@ -258,22 +329,26 @@ void
 CPetBasicTerm::
 scrollUp()
 {
-  uint n = nr_*nc_;
-
-  // move all chars left by nc_
-  uint i1 = 0;
+  if (nr_ == 0)
+    return;
 
-  for (uint i2 = nc_; i2 < n; ++i1, ++i2)
-    chars_[i1] = chars_[i2];
+  // old top row slot becomes new bottom row
+  if (++topRow_ >= nr_)
+    topRow_ = 0;
 
   // fill last row with spaces
-  for ( ; i1 < n; ++i1)
-    chars_[i1] = CPetDrawChar(uchar(' '));
+  auto i1 = cellIndex(nr_ - 1, 0);
+
+  for (uint c = 0; c < nc_; ++c)
+    chars_[i1 + c] = CPetDrawChar(uchar(' '));
 
   // update mouse pos to previous row
   if (r_ > 0)
     --r_;
 
+  // all rows have moved
+  markAllDirty();
+
   update();
 }
 
@@ -318,9 +393,12 @@ drawChar(const uchar &c)
 
   setChar(r_, c_, CPetDrawChar(c, 0, basic()->isReverse()));
 
-  if (isTty())
+  if (isTty()) {
     std::cout << c;
 
+    addBytesWritten(1);
+  }
+
   return true;
 }
 
@@ -339,22 +417,71 @@ drawChar(const CPetDrawChar &drawChar)
       CUtf8::append(str, drawChar.utf());
 
       std::cout << str;
+
+      addBytesWritten(str.size());
     }
     else {
       std::cout << drawChar.c();
+
+      addBytesWritten(1);
     }
   }
 
   return true;
 }
 
+void
+CPetBasicTerm::
+drawString(const std::string &str)
+{
+  bool echo    = (isTty() && ! isRaw());
+  bool reverse = basic()->isReverse();
+
+  std::string echoStr;
+
+  auto flushEcho = [&]() {
+    if (echo && ! echoStr.empty()) {
+      std::cout << echoStr;
+
+      addBytesWritten(echoStr.size());
+    }
+
+    echoStr.clear();
+  };
+
+  for (const auto &c : str) {
+    // wrap to next line
+    if (c_ >= int(nc_)) {
+      flushEcho();
+
+      enter();
+    }
+
+    if (r_ < 0 || r_ >= int(nr_))
+      break;
+
+    chars_[cellIndex(r_, c_)] = CPetDrawChar(uchar(c), 0, reverse);
+
+    markDirty(r_, c_);
+
+    if (echo)
+      echoStr += c;
+
+    ++c_;
+  }
+
+  flushEcho();
+
+  update();
+}
+
 //---
 
 bool
 CPetBasicTerm::
-drawPoint(long, long, long)
+drawPoint(long x, long y, long c)
 {
-  return true;
+  return plot(x, y, c);
 }
 
 //---
@@ -362,6 +489,18 @@ drawPoint(long, long, long)
 void
 CPetBasicTerm::
 enterLine()
+{
+  auto str = lineString();
+
+  cursorDown();
+  cursorLeftFull();
+
+  basic()->inputLine(str);
+}
+
+std::string
+CPetBasicTerm::
+lineString() const
 {
   std::string str;
 
@@ -405,10 +544,7 @@ enterLine()
       str += drawChar.c();
   }
 
-  cursorDown();
-  cursorLeftFull();
-
-  basic()->inputLine(str);
+  return str;
 }
 
 //---
@@ -416,6 +552,109 @@ enterLine()
 void
 CPetBasicTerm::
 update()
+{
+  updatePending_ = true;
+
+  checkUpdate();
+}
+
+void
+CPetBasicTerm::
+checkUpdate()
+{
+  if (! updatePending_)
+    return;
+
+  // redraw if enough time has passed since last redraw
+  if (maxUpdateRate_ > 0.0) {
+    auto t = CPetBasicUtil::currentUSecs();
+
+    if (double(t - lastUpdateTime_) < 1000000.0/maxUpdateRate_)
+      return;
+  }
+
+  flush();
+}
+
+void
+CPetBasicTerm::
+flush()
+{
+  if (! updatePending_)
+    return;
+
+  updatePending_ = false;
+
+  lastUpdateTime_ = CPetBasicUtil::currentUSecs();
+
+  // old and new cursor cells need repaint if cursor moved
+  if (r_ != lastCursorRow_ || c_ != lastCursorCol_) {
+    markDirty(lastCursorRow_, lastCursorCol_);
+    markDirty(r_, c_);
+
+    lastCursorRow_ = r_;
+    lastCursorCol_ = c_;
+  }
+
+  basic_->metrics().add(CPetBasicMetrics::Metric::TERM_UPDATES);
+
+  redraw();
+
+  dirtyRect_.reset();
+
+  frameBuffer_.resetDirty();
+}
+
+void
+CPetBasicTerm::
+addBytesWritten(size_t n)
+{
+  basic_->metrics().add(CPetBasicMetrics::Metric::BYTES_WRITTEN, long(n));
+}
+
+bool
+CPetBasicTerm::
+readKeyLine(std::string &line) const
+{
+  if (! basic_->hasKey())
+    return false;
+
+  uchar c;
+
+  while (basic_->popKey(c)) {
+    if (c == '\r' || c == '\n')
+      break;
+
+    line += char(c);
+  }
+
+  return true;
+}
+
+void
+CPetBasicTerm::
+markDirty(int r, int c)
+{
+  if (r < 0 || r >= int(nr_) || c < 0 || c >= int(nc_))
+    return;
+
+  dirtyRect_.add(r, c);
+}
+
+void
+CPetBasicTerm::
+markAllDirty()
+{
+  if (nr_ == 0 || nc_ == 0)
+    return;
+
+  dirtyRect_.add(0, 0);
+  dirtyRect_.add(int(nr_) - 1, int(nc_) - 1);
+}
+
+void
+CPetBasicTerm::
+redraw()
 {
 }
 
@@ -423,5 +662,7 @@ void
 CPetBasicTerm::
 delay(long t)
 {
+  flush();
+
   COSTimer::milli_sleep(uint(t));
 }
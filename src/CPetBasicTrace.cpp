@@ -0,0 +1,200 @@
+#include <CPetBasicTrace.h>
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+namespace {
+
+const char s_magic[8] = { 'P', 'E', 'T', 'T', 'R', 'A', 'C', 'E' };
+
+}
+
+const char *
+CPetBasicTrace::
+typeName(RecordType type)
+{
+  switch (type) {
+    case RecordType::START    : return "START";
+    case RecordType::STATEMENT: return "STATEMENT";
+    case RecordType::BRANCH   : return "BRANCH";
+    case RecordType::GET      : return "GET";
+    case RecordType::INPUT    : return "INPUT";
+    case RecordType::INPUT_END: return "INPUT_END";
+    case RecordType::RND      : return "RND";
+    case RecordType::TIME     : return "TIME";
+    default                   : return "NONE";
+  }
+}
+
+CPetBasicTrace::
+~CPetBasicTrace()
+{
+  close();
+}
+
+bool
+CPetBasicTrace::
+create(const std::string &fileName, size_t capacity)
+{
+  close();
+
+  if (capacity == 0) {
+    errorMsg_ = "Invalid trace capacity";
+    return false;
+  }
+
+  fd_ = ::open(fileName.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+
+  if (fd_ < 0) {
+    errorMsg_ = "Failed to create '" + fileName + "'";
+    return false;
+  }
+
+  mapSize_ = sizeof(Header) + capacity*sizeof(Record);
+
+  if (::ftruncate(fd_, off_t(mapSize_)) != 0) {
+    errorMsg_ = "Failed to size '" + fileName + "'";
+    close();
+    return false;
+  }
+
+  map_ = ::mmap(nullptr, mapSize_, PROT_READ | PROT_WRITE, MAP_SHARED, fd_, 0);
+
+  if (map_ == MAP_FAILED) {
+    map_ = nullptr;
+    errorMsg_ = "Failed to map '" + fileName + "'";
+    close();
+    return false;
+  }
+
+  header_  = static_cast<Header *>(map_);
+  records_ = reinterpret_cast<Record *>(static_cast<char *>(map_) + sizeof(Header));
+
+  memcpy(header_->magic, s_magic, sizeof(s_magic));
+
+  header_->version    = s_version;
+  header_->recordSize = sizeof(Record);
+  header_->capacity   = capacity;
+  header_->count      = 0;
+
+  fileName_ = fileName;
+  writing_  = true;
+  readInd_  = 0;
+
+  return true;
+}
+
+bool
+CPetBasicTrace::
+load(const std::string &fileName)
+{
+  close();
+
+  std::ifstream fs(fileName, std::ios::binary);
+
+  if (! fs) {
+    errorMsg_ = "Failed to open '" + fileName + "'";
+    return false;
+  }
+
+  Header header;
+
+  if (! fs.read(reinterpret_cast<char *>(&header), sizeof(header)) ||
+      memcmp(header.magic, s_magic, sizeof(s_magic)) != 0 ||
+      header.version != s_version || header.recordSize != sizeof(Record) ||
+      header.capacity == 0) {
+    errorMsg_ = "Invalid trace file '" + fileName + "'";
+    return false;
+  }
+
+  // only records written so far are valid
+  auto n = size_t(std::min(header.count, header.capacity));
+
+  loadRecords_.resize(size_t(header.capacity));
+
+  if (! fs.read(reinterpret_cast<char *>(loadRecords_.data()), std::streamsize(n*sizeof(Record)))) {
+    errorMsg_ = "Truncated trace file '" + fileName + "'";
+    loadRecords_.clear();
+    return false;
+  }
+
+  loadHeader_ = header;
+
+  header_  = &loadHeader_;
+  records_ = loadRecords_.data();
+
+  fileName_ = fileName;
+  writing_  = false;
+
+  rewind();
+
+  return true;
+}
+
+void
+CPetBasicTrace::
+close()
+{
+  if (map_) {
+    ::msync(map_, mapSize_, MS_ASYNC);
+    ::munmap(map_, mapSize_);
+  }
+
+  if (fd_ >= 0)
+    ::close(fd_);
+
+  fd_      = -1;
+  map_     = nullptr;
+  mapSize_ = 0;
+  header_  = nullptr;
+  records_ = nullptr;
+  writing_ = false;
+  readInd_ = 0;
+
+  loadRecords_.clear();
+}
+
+void
+CPetBasicTrace::
+addDouble(RecordType type, double r)
+{
+  uint64_t i;
+
+  memcpy(&i, &r, sizeof(i));
+
+  add(type, uint32_t(i & 0xffffffff), 0);
+  add(type, uint32_t(i >> 32), 1);
+}
+
+bool
+CPetBasicTrace::
+next(Record &record)
+{
+  if (atEnd())
+    return false;
+
+  record = this->record(readInd_++);
+
+  return true;
+}
+
+bool
+CPetBasicTrace::
+nextDouble(RecordType type, double &r)
+{
+  Record lo, hi;
+
+  if (! next(lo) || lo.type != type || lo.aux != 0 ||
+      ! next(hi) || hi.type != type || hi.aux != 1)
+    return false;
+
+  auto i = (uint64_t(hi.value) << 32) | lo.value;
+
+  memcpy(&r, &i, sizeof(r));
+
+  return true;
+}
@@ -1,33 +1,52 @@
 #include <CExprI.h>
+#include <atomic>
+
+namespace {
+
+std::atomic<long> s_numCreated { 0 };
+
+}
+
+long
+CExprValue::
+numCreated()
+{
+  return s_numCreated.load(std::memory_order_relaxed);
+}
 
 CExprValue::
 CExprValue() :
  type_(CExprValueType::NONE)
 {
+  s_numCreated.fetch_add(1, std::memory_order_relaxed);
 }
 
 CExprValue::
 CExprValue(const CExprBooleanValue &boolean) :
  type_(CExprValueType::BOOLEAN), base_(boolean.dup())
 {
+  s_numCreated.fetch_add(1, std::memory_order_relaxed);
 }
 
 CExprValue::
 CExprValue(const CExprIntegerValue &integer) :
  type_(CExprValueType::INTEGER), base_(integer.dup())
 {
+  s_numCreated.fetch_add(1, std::memory_order_relaxed);
 }
 
 CExprValue::
 CExprValue(const CExprRealValue &real) :
  type_(CExprValueType::REAL), base_(real.dup())
 {
+  s_numCreated.fetch_add(1, std::memory_order_relaxed);
 }
 
 CExprValue::
 CExprValue(const CExprStringValue &str) :
  type_(CExprValueType::STRING), base_(str.dup())
 {
+  s_numCreated.fetch_add(1, std::memory_order_relaxed);
 }
 
 CExprValue::
@@ -0,0 +1,541 @@
+#include <CPetBasic.h>
+#include <CPetBasicMetrics.h>
+#include <CPetBasicUtil.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <new>
+#include <sstream>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+// benchmark driver : runs a fixed set of workloads with the headless terminal and
+// writes one JSON line per workload (median of repeated runs after warm up runs).
+// Each workload runs in a forked child so its peak RSS is its own.
+//
+// Results can be compared against a baseline (-baseline <file>) and the current
+// results saved as a new baseline (-save <file>). Rates are machine specific so a
+// regression only fails the run with -strict (against a baseline from this machine).
+
+//---
+
+// count heap allocations made while a run is timed (all replaceable allocation
+// functions are replaced so new/delete pairs always match)
+static std::atomic<long> s_numAllocs { 0 };
+
+static void *
+countedAlloc(std::size_t n, std::size_t align=0)
+{
+  s_numAllocs.fetch_add(1, std::memory_order_relaxed);
+
+  if (n == 0) n = 1;
+
+  void *p = nullptr;
+
+  if (align > alignof(std::max_align_t)) {
+    // aligned_alloc size must be multiple of alignment
+    n = (n + align - 1) & ~(align - 1);
+
+    p = std::aligned_alloc(align, n);
+  }
+  else
+    p = std::malloc(n);
+
+  return p;
+}
+
+static void *
+checkedAlloc(std::size_t n, std::size_t align=0)
+{
+  auto *p = countedAlloc(n, align);
+
+  if (! p)
+    throw std::bad_alloc();
+
+  return p;
+}
+
+void *operator new  (std::size_t n) { return checkedAlloc(n); }
+void *operator new[](std::size_t n) { return checkedAlloc(n); }
+
+void *operator new  (std::size_t n, std::align_val_t a) {
+  return checkedAlloc(n, std::size_t(a)); }
+void *operator new[](std::size_t n, std::align_val_t a) {
+  return checkedAlloc(n, std::size_t(a)); }
+
+void *operator new  (std::size_t n, const std::nothrow_t &) noexcept {
+  return countedAlloc(n); }
+void *operator new[](std::size_t n, const std::nothrow_t &) noexcept {
+  return countedAlloc(n); }
+
+void *operator new  (std::size_t n, std::align_val_t a, const std::nothrow_t &) noexcept {
+  return countedAlloc(n, std::size_t(a)); }
+void *operator new[](std::size_t n, std::align_val_t a, const std::nothrow_t &) noexcept {
+  return countedAlloc(n, std::size_t(a)); }
+
+void operator delete  (void *p) noexcept { std::free(p); }
+void operator delete[](void *p) noexcept { std::free(p); }
+void operator delete  (void *p, std::size_t) noexcept { std::free(p); }
+void operator delete[](void *p, std::size_t) noexcept { std::free(p); }
+void operator delete  (void *p, const std::nothrow_t &) noexcept { std::free(p); }
+void operator delete[](void *p, const std::nothrow_t &) noexcept { std::free(p); }
+void operator delete  (void *p, std::align_val_t) noexcept { std::free(p); }
+void operator delete[](void *p, std::align_val_t) noexcept { std::free(p); }
+void operator delete  (void *p, std::size_t, std::align_val_t) noexcept { std::free(p); }
+void operator delete[](void *p, std::size_t, std::align_val_t) noexcept { std::free(p); }
+void operator delete  (void *p, std::align_val_t, const std::nothrow_t &) noexcept {
+  std::free(p); }
+void operator delete[](void *p, std::align_val_t, const std::nothrow_t &) noexcept {
+  std::free(p); }
+
+//---
+
+namespace {
+
+// workload : program file and optional input script (relative to data dir) and limit
+// on statements run. Every workload must run to its end (stopped) without logging
+// any errors, otherwise the benchmark fails.
+struct Workload {
+  const char* name;
+  const char* fileName;
+  const char* keysFile;
+  long        maxStatements;
+};
+
+const std::vector<Workload> s_workloads = {
+  { "mandelbrot"     , "mandelbrot.bas"           , nullptr             , 0 },
+  { "mandelbrot2"    , "mandelbrot2.bas"          , "bench/anykey.keys" , 0 },
+  { "mandelbrot3"    , "mandelbrot3.bas"          , "bench/anykey.keys" , 0 },
+  { "mandelbrot_plot", "bench/mandelbrot_plot.bas", nullptr             , 0 },
+  { "loops"          , "bench/loops.bas"          , nullptr             , 0 },
+  { "strings"        , "bench/strings.bas"        , nullptr             , 0 },
+  { "valley"         , "valley/valley.bas"        , "bench/valley.keys" , 1000000 },
+};
+
+// fixed RND seed so runs are repeatable
+const ulong s_randomSeed = 1;
+
+struct Result {
+  std::string name;
+  std::string status;
+  int         runs        { 0 };
+  long        statements  { 0 };
+  long        wallUSecs   { 0 };
+  long        minUSecs    { 0 };
+  long        maxUSecs    { 0 };
+  double      rate        { 0.0 }; // statements per second
+  long        allocs      { 0 };
+  long        valueAllocs { 0 };
+  long        peakRSS     { 0 };   // KB (peak of workload's process)
+  double      baseRate    { 0.0 }; // baseline statements per second
+};
+
+struct RunData {
+  CPetBasic::RunStatus status      { CPetBasic::RunStatus::STOPPED };
+  long                 statements  { 0 };
+  long                 usecs       { 0 };
+  long                 allocs      { 0 };
+  long                 valueAllocs { 0 };
+};
+
+const char *statusName(CPetBasic::RunStatus status)
+{
+  switch (status) {
+    case CPetBasic::RunStatus::RUNNING: return "limit";
+    case CPetBasic::RunStatus::WAITING: return "waiting";
+    case CPetBasic::RunStatus::STOPPED: return "stopped";
+    default:                            return "error";
+  }
+}
+
+// peak RSS of this process (workload child)
+long peakRSS()
+{
+  struct rusage usage;
+
+  if (getrusage(RUSAGE_SELF, &usage) != 0)
+    return 0;
+
+  return usage.ru_maxrss;
+}
+
+// run workload once in new interpreter (load time not included)
+bool runWorkloadData(const Workload &workload, const std::string &dataDir, RunData &runData)
+{
+  CPetBasic basic;
+
+  basic.setHeadless();
+
+  if (! basic.loadFile(dataDir + "/" + workload.fileName)) {
+    std::cerr << "Failed to load '" << workload.fileName << "'\n";
+    return false;
+  }
+
+  if (workload.keysFile && ! basic.loadInputScript(dataDir + "/" + workload.keysFile))
+    return false;
+
+  // fixed seed and virtual clock so each run executes the same statements
+  basic.setRandomSeed(s_randomSeed);
+  basic.setVirtualClock(true);
+
+  using Metric = CPetBasicMetrics::Metric;
+
+  static const long sliceStatements = 10000;
+
+  basic.startRun();
+
+  basic.resetMetrics();
+
+  auto allocs = s_numAllocs.load();
+  auto t1     = CPetBasicUtil::currentUSecs();
+
+  while (true) {
+    runData.status = basic.runFor(sliceStatements);
+
+    if (runData.status == CPetBasic::RunStatus::STOPPED ||
+        runData.status == CPetBasic::RunStatus::ERROR)
+      break;
+
+    if (workload.maxStatements > 0 &&
+        basic.metrics().value(Metric::STATEMENTS) >= workload.maxStatements)
+      break;
+
+    // delays don't wait in benchmark
+    if (runData.status == CPetBasic::RunStatus::WAITING &&
+        basic.waitType() == CPetBasic::WaitType::DELAY) {
+      basic.skipDelay();
+      continue;
+    }
+
+    // input script keys are typed by interpreter so waiting for input means script done
+    if (runData.status == CPetBasic::RunStatus::WAITING && ! basic.canResume())
+      break;
+  }
+
+  runData.usecs  = CPetBasicUtil::currentUSecs() - t1;
+  runData.allocs = s_numAllocs.load() - allocs;
+
+  basic.updateMetrics();
+
+  runData.statements  = basic.metrics().value(Metric::STATEMENTS);
+  runData.valueAllocs = basic.metrics().value(Metric::VALUE_ALLOCS);
+
+  return true;
+}
+
+// run workload and check it ran to its end without the interpreter logging anything
+// (load, compile and run errors are written to stderr)
+bool runWorkload(const Workload &workload, const std::string &dataDir, RunData &runData)
+{
+  std::stringstream errs;
+
+  auto *buf = std::cerr.rdbuf(errs.rdbuf());
+
+  bool rc = runWorkloadData(workload, dataDir, runData);
+
+  std::cerr.rdbuf(buf);
+
+  if (errs.str() != "") {
+    std::cerr << errs.str();
+    rc = false;
+  }
+
+  if (rc && runData.status != CPetBasic::RunStatus::STOPPED) {
+    std::cerr << "Workload '" << workload.name << "' did not run to end (" <<
+                 statusName(runData.status) << ")\n";
+    rc = false;
+  }
+
+  if (! rc)
+    std::cerr << "Workload '" << workload.name << "' failed\n";
+
+  return rc;
+}
+
+bool benchWorkload(const Workload &workload, const std::string &dataDir,
+                   int numWarmup, int numRuns, Result &result)
+{
+  result.name = workload.name;
+
+  RunData runData;
+
+  for (int i = 0; i < numWarmup; ++i) {
+    if (! runWorkload(workload, dataDir, runData))
+      return false;
+  }
+
+  std::vector<RunData> runDatas;
+
+  for (int i = 0; i < numRuns; ++i) {
+    if (! runWorkload(workload, dataDir, runData))
+      return false;
+
+    runDatas.push_back(runData);
+  }
+
+  if (runDatas.empty())
+    return false;
+
+  // report median run
+  std::sort(runDatas.begin(), runDatas.end(),
+            [](const RunData &lhs, const RunData &rhs) { return lhs.usecs < rhs.usecs; });
+
+  const auto &median = runDatas[runDatas.size()/2];
+
+  result.status      = statusName(median.status);
+  result.runs        = int(runDatas.size());
+  result.statements  = median.statements;
+  result.wallUSecs   = median.usecs;
+  result.minUSecs    = runDatas.front().usecs;
+  result.maxUSecs    = runDatas.back ().usecs;
+  result.rate        = (median.usecs > 0 ? 1E6*double(median.statements)/median.usecs : 0.0);
+  result.allocs      = median.allocs;
+  result.valueAllocs = median.valueAllocs;
+  result.peakRSS     = peakRSS();
+
+  return true;
+}
+
+std::string resultJson(const Result &result, double tolerance)
+{
+  std::stringstream ss;
+
+  ss << "{\"name\": \"" << result.name << "\", \"status\": \"" << result.status << "\"" <<
+        ", \"runs\": " << result.runs << ", \"statements\": " << result.statements <<
+        ", \"wall_usecs\": " << result.wallUSecs << ", \"min_usecs\": " << result.minUSecs <<
+        ", \"max_usecs\": " << result.maxUSecs << ", \"stmts_per_sec\": " << long(result.rate) <<
+        ", \"allocs\": " << result.allocs << ", \"value_allocs\": " << result.valueAllocs <<
+        ", \"peak_rss_kb\": " << result.peakRSS;
+
+  if (result.baseRate > 0.0) {
+    auto ratio = result.rate/result.baseRate;
+
+    ss << ", \"baseline_stmts_per_sec\": " << long(result.baseRate) <<
+          ", \"speedup\": " << ratio <<
+          ", \"regression\": " << (ratio < 1.0 - tolerance ? "true" : "false");
+  }
+
+  ss << "}";
+
+  return ss.str();
+}
+
+// read name and rate from baseline JSON lines
+bool readBaseline(const std::string &fileName, std::map<std::string, double> &rates)
+{
+  std::ifstream fs(fileName);
+
+  if (! fs)
+    return false;
+
+  std::string line;
+
+  while (std::getline(fs, line)) {
+    auto p1 = line.find("\"name\": \"");
+    auto p2 = line.find("\"stmts_per_sec\": ");
+
+    if (p1 == std::string::npos || p2 == std::string::npos)
+      continue;
+
+    p1 += 9;
+
+    auto p3 = line.find('"', p1);
+
+    if (p3 == std::string::npos)
+      continue;
+
+    rates[line.substr(p1, p3 - p1)] = std::atof(line.c_str() + p2 + 17);
+  }
+
+  return true;
+}
+
+enum class BenchStatus {
+  OK,
+  FAILED,
+  REGRESSED
+};
+
+// run workload in forked child (own heap and peak RSS) and return result JSON lines
+// (with baseline comparison and for saving)
+BenchStatus forkWorkload(const Workload &workload, const std::string &dataDir,
+                         int numWarmup, int numRuns, double baseRate, double tolerance,
+                         std::string &line, std::string &saveLine)
+{
+  int fds[2];
+
+  if (pipe(fds) != 0) {
+    std::cerr << "Failed to create pipe\n";
+    return BenchStatus::FAILED;
+  }
+
+  std::cout.flush();
+  std::cerr.flush();
+
+  auto pid = fork();
+
+  if (pid < 0) {
+    std::cerr << "Failed to fork\n";
+    ::close(fds[0]);
+    ::close(fds[1]);
+    return BenchStatus::FAILED;
+  }
+
+  if (pid == 0) {
+    ::close(fds[0]);
+
+    Result result;
+
+    if (! benchWorkload(workload, dataDir, numWarmup, numRuns, result))
+      _exit(int(BenchStatus::FAILED));
+
+    result.baseRate = baseRate;
+
+    auto str = resultJson(result, tolerance) + "\n";
+
+    // saved baseline only has current values
+    result.baseRate = 0.0;
+
+    str += resultJson(result, tolerance) + "\n";
+
+    if (write(fds[1], str.c_str(), str.size()) != ssize_t(str.size()))
+      _exit(int(BenchStatus::FAILED));
+
+    ::close(fds[1]);
+
+    std::cerr.flush();
+
+    bool regressed = (baseRate > 0.0 && result.rate < (1.0 - tolerance)*baseRate);
+
+    _exit(int(regressed ? BenchStatus::REGRESSED : BenchStatus::OK));
+  }
+
+  ::close(fds[1]);
+
+  std::string str;
+
+  char buffer[1024];
+  ssize_t n;
+
+  while ((n = read(fds[0], buffer, sizeof(buffer))) > 0)
+    str.append(buffer, size_t(n));
+
+  ::close(fds[0]);
+
+  int status = 0;
+
+  if (waitpid(pid, &status, 0) != pid || ! WIFEXITED(status))
+    return BenchStatus::FAILED;
+
+  auto rc = BenchStatus(WEXITSTATUS(status));
+
+  if (rc == BenchStatus::FAILED)
+    return rc;
+
+  std::stringstream ss(str);
+
+  if (! std::getline(ss, line) || ! std::getline(ss, saveLine))
+    return BenchStatus::FAILED;
+
+  return rc;
+}
+
+}
+
+//---
+
+int
+main(int argc, char **argv)
+{
+  std::string dataDir = "data";
+  std::string baselineFile, saveFile;
+
+  int    numWarmup = 1;
+  int    numRuns   = 5;
+  double tolerance = 0.1;
+  bool   strict    = false;
+
+  std::vector<std::string> names;
+
+  for (int i = 1; i < argc; ++i) {
+    if (argv[i][0] == '-') {
+      auto arg = std::string(&argv[i][1]);
+
+      if      (arg == "data"      && i + 1 < argc) dataDir      = argv[++i];
+      else if (arg == "warmup"    && i + 1 < argc) numWarmup    = std::atoi(argv[++i]);
+      else if (arg == "repeat"    && i + 1 < argc) numRuns      = std::atoi(argv[++i]);
+      else if (arg == "baseline"  && i + 1 < argc) baselineFile = argv[++i];
+      else if (arg == "save"      && i + 1 < argc) saveFile     = argv[++i];
+      else if (arg == "tolerance" && i + 1 < argc) tolerance    = std::atof(argv[++i])/100.0;
+      else if (arg == "strict"   ) strict = true;
+      else if (arg == "list") {
+        for (const auto &workload : s_workloads)
+          std::cout << workload.name << "\n";
+        return 0;
+      }
+      else {
+        std::cerr << "Usage: CPetBasicBench [-data <dir>] [-warmup <n>] [-repeat <n>] "
+                     "[-baseline <file>] [-save <file>] [-tolerance <percent>] [-strict] [-list] "
+                     "[<workload> ...]\n";
+        return 1;
+      }
+    }
+    else
+      names.push_back(argv[i]);
+  }
+
+  std::map<std::string, double> baseRates;
+
+  if (baselineFile != "" && ! readBaseline(baselineFile, baseRates))
+    std::cerr << "Failed to read '" << baselineFile << "'\n";
+
+  std::vector<std::string> lines;
+
+  bool failed = false, regressed = false;
+
+  for (const auto &workload : s_workloads) {
+    if (! names.empty() && std::find(names.begin(), names.end(), workload.name) == names.end())
+      continue;
+
+    auto pb = baseRates.find(workload.name);
+
+    double baseRate = (pb != baseRates.end() ? (*pb).second : 0.0);
+
+    std::string line, saveLine;
+
+    auto rc = forkWorkload(workload, dataDir, numWarmup, numRuns, baseRate, tolerance,
+                           line, saveLine);
+
+    if (rc == BenchStatus::FAILED) {
+      failed = true;
+      continue;
+    }
+
+    if (rc == BenchStatus::REGRESSED)
+      regressed = true;
+
+    std::cout << line << std::endl;
+
+    lines.push_back(saveLine);
+  }
+
+  // don't replace baseline with partial results
+  if (saveFile != "" && ! failed) {
+    std::ofstream fs(saveFile);
+
+    if (! fs) {
+      std::cerr << "Failed to write '" << saveFile << "'\n";
+      return 1;
+    }
+
+    for (const auto &line : lines)
+      fs << line << "\n";
+  }
+
+  return (failed || (strict && regressed) ? 1 : 0);
+}
@@ -0,0 +1,369 @@
+#include <CPetBasic.h>
+
+#include <cassert>
+#include <iostream>
+
+// PETSCII/draw char translation check : compares CPetBasic::drawCharToPet and
+// CPetBasic::petToDrawChar (table driven) with the switch based implementation they
+// replaced (kept below unchanged) for every PETSCII code, every ascii char and every
+// code point up to maxUtf, normal and reversed.
+
+namespace {
+
+// highest code point checked (graphic characters are all below 0x20000)
+const ulong maxUtf = 0x20000;
+
+//---
+
+// previous (switch based) implementation
+
+CPetsciChar
+oldDrawCharToPet(const CPetDrawChar &drawChar)
+{
+  CPetsciChar pet;
+
+  if (drawChar.utf() > 0) {
+    auto utfToPet = [](ulong utf1) -> uchar {
+      switch (utf1) {
+        case 0x1fb79: return 64 ; // horizontal mid line
+        case 0x2660 : return 65 ; // spades suit
+        case 0x1fb72: return 66 ; // vertical line 1
+        case 0x1fb78: return 67 ; // horizontal line 1
+        case 0x1fb77: return 68 ; // horizontal line 2
+        case 0x1fb76: return 69 ; // horizontal line 3
+        case 0x1fb7a: return 70 ; // horizontal line 4
+        case 0x1fb71: return 71 ; // vertical line 2
+        case 0x1fb74: return 72 ; // vertical line 3
+        case 0x256e : return 73 ; // round corner ll
+        case 0x2570 : return 74 ; // round corner ur
+        case 0x256f : return 75 ; // round corner ul
+        case 0x1fb7c: return 76 ; // square corner ll
+        case 0x2572 : return 77 ; // diagonal tl->br
+        case 0x2571 : return 78 ; // diagonal bl->tr
+        case 0x1fb7d: return 79 ; // square corner tl
+        case 0x1fb7e: return 80 ; // square corner tr
+        case 0x25cf : return 81 ; // white filled circle, black square
+        case 0x1fb7b: return 82 ; // horizontal line 5
+        case 0x2665 : return 83 ; // hearts suit
+        case 0x1fb70: return 84 ; // vertical line 4
+        case 0x256d : return 85 ; // round corner lr
+        case 0x2573 : return 86 ; // cross
+        case 0x25cb : return 87 ; // white stroked circle, black square
+        case 0x2663 : return 88 ; // clubs suit
+        case 0x1fb75: return 89 ; // vertical line 5
+        case 0x2666 : return 90 ; // diamonds suit
+        case 0x253c : return 91 ; // plus
+        case 0x1fb8c: return 92 ; // hash fill left half
+        case 0x2502 : return 93 ; // vertical line 5
+        case 0x03c0 : return 94 ; // pi
+        case 0x25e5 : return 95 ; // filled tr triangle
+        case 0x00a0 : return 96 ; // space
+        case 0x258c : return 97 ; // filled left side
+        case 0x2584 : return 98 ; // filled bottom side
+        case 0x2594 : return 99 ; // filled top side
+        case 0x2581 : return 100; // horizontal line bottom
+        case 0x258f : return 101; // vertical line left
+        case 0x2592 : return 102; // hash fill
+        case 0x2595 : return 103; // line top and right
+        case 0x1fb8f: return 104; // hash fill bottom half
+        case 0x25e4 : return 105; // filled tl triangle
+        case 0x1fb87: return 106; // thick line right
+        case 0x251c : return 107; // vertical line mid and to right
+        case 0x2597 : return 108; // filled br quarter
+        case 0x2514 : return 109; // stroked tr quarter
+        case 0x2510 : return 110; // stroked bl quarter
+        case 0x2582 : return 111; // thick line bottom
+        case 0x250c : return 112; // stroked br quarter
+        case 0x2534 : return 113; // horizontal line mid and to top
+        case 0x252c : return 114; // horizontal line mid and to bottom
+        case 0x2524 : return 115; // vertical line mid and to left
+        case 0x258e : return 116; // thick line left
+        case 0x258d : return 117; // double thick line left
+        case 0x1fb88: return 118; // double thick line right
+        case 0x1fb82: return 119; // double thick line top
+        case 0x1fb83: return 120; // triple thick line top
+        case 0x2583 : return 121; // quadruple thick line bottom
+        case 0x1fb7f: return 122; // stroked br quarter
+        case 0x2596 : return 123; // filled bl quarter
+        case 0x259d : return 124; // filled tr quarter
+        case 0x2518 : return 125; // stroked tl quarter
+        case 0x2598 : return 126; // filled tl quarter
+        case 0x259a : return 127; // filled tl and br quarter
+        default     : return 32;
+      }
+    };
+
+    pet = CPetsciChar(utfToPet(drawChar.utf()));
+  }
+  else {
+    auto asciiToPet = [](uchar ascii1) -> uchar {
+      switch (ascii1) {
+        case '@': return 0;
+        case 'A': case 'B': case 'C': case 'D': case 'E': case 'F': case 'G': case 'H':
+        case 'I': case 'J': case 'K': case 'L': case 'M': case 'N': case 'O': case 'P':
+        case 'Q': case 'R': case 'S': case 'T': case 'U': case 'V': case 'W': case 'X':
+        case 'Y': case 'Z':
+          return (ascii1 - 'A' + 1);
+        case 'a': case 'b': case 'c': case 'd': case 'e': case 'f': case 'g': case 'h':
+        case 'i': case 'j': case 'k': case 'l': case 'm': case 'n': case 'o': case 'p':
+        case 'q': case 'r': case 's': case 't': case 'u': case 'v': case 'w': case 'x':
+        case 'y': case 'z':
+          return (ascii1 - 'a' + 1);
+        case '[': return 27;
+        case '\\': return 28;
+        case ']': return 29;
+        case '^': return 30; // up arrow
+        case '~': return 31; // back arrow
+        case ' ': return 32;
+        case '!': return 33;
+        case '"': return 34;
+        case '#': return 35;
+        case '$': return 36;
+        case '%': return 37;
+        case '&': return 38;
+        case '\'': return 39;
+        case '(': return 40;
+        case ')': return 41;
+        case '*': return 42;
+        case '+': return 43;
+        case ',': return 44;
+        case '-': return 45;
+        case '.': return 46;
+        case '/': return 47;
+        case '0': case '1': case '2': case '3': case '4':
+        case '5': case '6': case '7': case '8': case '9':
+          return (ascii1 - '0' + 48);
+        case ':': return 58;
+        case ';': return 59;
+        case '<': return 60;
+        case '=': return 61;
+        case '>': return 62;
+        case '?': return 63;
+        // 64-127 : graphic characters
+        default: return 32;
+      }
+    };
+
+    pet = CPetsciChar(asciiToPet(drawChar.c()));
+  }
+
+  if (drawChar.isReverse())
+    pet.reverse();
+
+  return pet;
+}
+
+CPetDrawChar
+oldPetToDrawChar(const CPetsciChar &pet)
+{
+  CPetsciChar pet1 = pet;
+
+  CPetDrawChar drawChar;
+
+  if (pet1.isReversed()) {
+    pet1.unreverse();
+
+    drawChar.setReverse(true);
+  }
+
+  auto setC = [&](uchar c) {
+    drawChar.setC(c);
+    return drawChar;
+  };
+
+  // A-Z
+  if (pet1.c() >= 1 && pet1.c() <= 26)
+    return setC(uchar('A' + pet1.c() - 1));
+
+  // 0-9
+  if (pet1.c() >= 48 && pet1.c() <= 57)
+    return setC('0' + pet1.c() - 48);
+
+  // 0-63 normal characters
+  if (pet1.c() < 64) {
+    switch (pet1.c()) {
+      case 0 : return setC('@');
+      // A-Z (1-26)
+      case 27: return setC('[');
+      case 28: return setC('\\');
+      case 29: return setC(']');
+      case 30: return setC('^'); // up arrow
+      case 31: return setC('~'); // left arrow
+      case 32: return setC(' ');
+      case 33: return setC('!');
+      case 34: return setC('"');
+      case 35: return setC('#');
+      case 36: return setC('$');
+      case 37: return setC('%');
+      case 38: return setC('&');
+      case 39: return setC('\'');
+      case 40: return setC('(');
+      case 41: return setC(')');
+      case 42: return setC('*');
+      case 43: return setC('+');
+      case 44: return setC(',');
+      case 45: return setC('-');
+      case 46: return setC('.');
+      case 47: return setC('/');
+      // 0-9 (48-57)
+      case 58: return setC(':');
+      case 59: return setC(';');
+      case 60: return setC('<');
+      case 61: return setC('=');
+      case 62: return setC('>');
+      case 63: return setC('?');
+    }
+  }
+
+  auto setUtf = [&](ulong utf) {
+    drawChar.setUtf(utf);
+    return drawChar;
+  };
+
+  // 64-127 : graphic characters
+  switch (pet1.c()) {
+    case 64 : return setUtf(0x1fb79); // horizontal mid line
+    case 65 : return setUtf(0x2660 ); // spades suit
+    case 66 : return setUtf(0x1fb72); // vertical line 1
+    case 67 : return setUtf(0x1fb78); // horizontal line 1
+    case 68 : return setUtf(0x1fb77); // horizontal line 2
+    case 69 : return setUtf(0x1fb76); // horizontal line 3
+    case 70 : return setUtf(0x1fb7a); // horizontal line 4
+    case 71 : return setUtf(0x1fb71); // vertical line 2
+    case 72 : return setUtf(0x1fb74); // vertical line 3
+    case 73 : return setUtf(0x256e ); // round corner ll
+    case 74 : return setUtf(0x2570 ); // round corner ur
+    case 75 : return setUtf(0x256f ); // round corner ul
+    case 76 : return setUtf(0x1fb7c); // square corner ll
+    case 77 : return setUtf(0x2572 ); // diagonal tl->br
+    case 78 : return setUtf(0x2571 ); // diagonal bl->tr
+    case 79 : return setUtf(0x1fb7d); // square corner tl
+    case 80 : return setUtf(0x1fb7e); // square corner tr
+    case 81 : return setUtf(0x25cf ); // white filled circle, black square
+    case 82 : return setUtf(0x1fb7b); // horizontal line 5
+    case 83 : return setUtf(0x2665 ); // hearts suit
+    case 84 : return setUtf(0x1fb70); // vertical line 4
+    case 85 : return setUtf(0x256d ); // round corner lr
+    case 86 : return setUtf(0x2573 ); // cross
+    case 87 : return setUtf(0x25cb ); // white stroked circle, black square
+    case 88 : return setUtf(0x2663 ); // clubs suit
+    case 89 : return setUtf(0x1fb75); // vertical line 5
+    case 90 : return setUtf(0x2666 ); // diamonds suit
+    case 91 : return setUtf(0x253c ); // plus
+    case 92 : return setUtf(0x1fb8c); // hash fill left half
+    case 93 : return setUtf(0x2502 ); // vertical line 5
+    case 94 : return setUtf(0x03c0 ); // pi
+    case 95 : return setUtf(0x25e5 ); // filled tr triangle
+    case 96 : return setUtf(0x00a0 ); // space
+    case 97 : return setUtf(0x258c ); // filled left side
+    case 98 : return setUtf(0x2584 ); // filled bottom side
+    case 99 : return setUtf(0x2594 ); // filled top side
+    case 100: return setUtf(0x2581 ); // horizontal line bottom
+    case 101: return setUtf(0x258f ); // vertical line left
+    case 102: return setUtf(0x2592 ); // hash fill
+    case 103: return setUtf(0x2595 ); // line top and right
+    case 104: return setUtf(0x1fb8f); // hash fill bottom half
+    case 105: return setUtf(0x25e4 ); // filled tl triangle
+    case 106: return setUtf(0x1fb87); // thick line right
+    case 107: return setUtf(0x251c ); // vertical line mid and to right
+    case 108: return setUtf(0x2597 ); // filled br quarter
+    case 109: return setUtf(0x2514 ); // stroked tr quarter
+    case 110: return setUtf(0x2510 ); // stroked bl quarter
+    case 111: return setUtf(0x2582 ); // thick line bottom
+    case 112: return setUtf(0x250c ); // stroked br quarter
+    case 113: return setUtf(0x2534 ); // horizontal line mid and to top
+    case 114: return setUtf(0x252c ); // horizontal line mid and to bottom
+    case 115: return setUtf(0x2524 ); // vertical line mid and to left
+    case 116: return setUtf(0x258e ); // thick line left
+    case 117: return setUtf(0x258d ); // double thick line left
+    case 118: return setUtf(0x1fb88); // double thick line right
+    case 119: return setUtf(0x1fb82); // double thick line top
+    case 120: return setUtf(0x1fb83); // triple thick line top
+    case 121: return setUtf(0x2583 ); // quadruple thick line bottom
+    case 122: return setUtf(0x1fb7f); // stroked br quarter
+    case 123: return setUtf(0x2596 ); // filled bl quarter
+    case 124: return setUtf(0x259d ); // filled tr quarter
+    case 125: return setUtf(0x2518 ); // stroked tl quarter
+    case 126: return setUtf(0x2598 ); // filled tl quarter
+    case 127: return setUtf(0x259a ); // filled tl and br quarter
+  }
+
+  // TODO ?
+  assert(false);
+
+  return drawChar;
+}
+
+//---
+
+bool sameDrawChar(const CPetDrawChar &lhs, const CPetDrawChar &rhs)
+{
+  return (lhs.value() == rhs.value());
+}
+
+std::string drawCharStr(const CPetDrawChar &drawChar)
+{
+  std::string str;
+
+  if (drawChar.utf() > 0)
+    str = "utf " + std::to_string(drawChar.utf());
+  else
+    str = "char " + std::to_string(int(drawChar.c()));
+
+  if (drawChar.isReverse())
+    str += " (reversed)";
+
+  return str;
+}
+
+}
+
+//---
+
+int
+main(int, char **)
+{
+  long numChecked = 0, numFailed = 0;
+
+  // PETSCII to draw char
+  for (uint i = 0; i < 256; ++i) {
+    auto pet = CPetsciChar(uchar(i));
+
+    auto drawChar1 = oldPetToDrawChar(pet);
+    auto drawChar2 = CPetBasic::petToDrawChar(pet);
+
+    ++numChecked;
+
+    if (! sameDrawChar(drawChar1, drawChar2)) {
+      std::cerr << "FAIL petToDrawChar " << i << " : expected " << drawCharStr(drawChar1) <<
+                   " got " << drawCharStr(drawChar2) << "\n";
+      ++numFailed;
+    }
+  }
+
+  // draw char to PETSCII
+  auto checkDrawChar = [&](const CPetDrawChar &drawChar) {
+    auto pet1 = oldDrawCharToPet(drawChar);
+    auto pet2 = CPetBasic::drawCharToPet(drawChar);
+
+    ++numChecked;
+
+    if (pet1.c() != pet2.c()) {
+      std::cerr << "FAIL drawCharToPet " << drawCharStr(drawChar) << " : expected " <<
+                   int(pet1.c()) << " got " << int(pet2.c()) << "\n";
+      ++numFailed;
+    }
+  };
+
+  for (int reverse = 0; reverse < 2; ++reverse) {
+    for (uint i = 0; i < 256; ++i)
+      checkDrawChar(CPetDrawChar(uchar(i), 0, reverse));
+
+    for (ulong utf = 1; utf < maxUtf; ++utf)
+      checkDrawChar(CPetDrawChar(0, utf, reverse));
+  }
+
+  std::cout << numChecked << " checked, " << numFailed << " failed\n";
+
+  return (numFailed > 0 ? 1 : 0);
+}
@@ -0,0 +1,310 @@
+#include <CPetBasic.h>
+#include <CPetBasicNullTerm.h>
+
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <unistd.h>
+
+// golden output check : runs the sample programs with the headless terminal (fixed RND
+// seed, virtual clock and scripted keys so runs are repeatable) and compares the final
+// screen, anything logged to stderr, the run status and (for PLOT programs) the size of
+// the framebuffer PPM dump against stored output in <data>/check/<name>.out. -update
+// rewrites the stored output.
+
+namespace {
+
+// check case : program and optional input script (relative to data dir) and whether
+// to check PPM dump
+struct Case {
+  const char* name;
+  const char* fileName;
+  const char* keysFile;
+  bool        ppm { false };
+};
+
+const std::vector<Case> s_cases = {
+  { "chars"             , "chars.bas"             , nullptr },
+  { "clr"               , "clr.bas"               , nullptr },
+  { "data"              , "data.bas"              , nullptr },
+  { "deffn"             , "deffn.bas"             , nullptr },
+  { "for_goto"          , "for_goto.bas"          , nullptr },
+  { "gosub_test"        , "gosub_test.bas"        , nullptr },
+  { "if_else"           , "if_else.bas"           , nullptr },
+  { "let"               , "let.bas"               , nullptr },
+  { "mandelbrot"        , "mandelbrot.bas"        , nullptr },
+  { "mandelbrot2"       , "mandelbrot2.bas"       , "bench/anykey.keys" },
+  { "mandelbrot3"       , "mandelbrot3.bas"       , "bench/anykey.keys" },
+  { "mandelbrot_display", "mandelbrot-display.bas", "bench/anykey.keys" },
+  { "test_assert"       , "test_assert.bas"       , nullptr },
+  { "test_ctrl"         , "test_ctrl.bas"         , nullptr },
+  { "test_def"          , "test_def.bas"          , nullptr },
+  { "test_delay"        , "test_delay.bas"        , nullptr },
+  { "test_dim"          , "test_dim.bas"          , nullptr },
+  { "test_for"          , "test_for.bas"          , nullptr },
+  { "test_for_1"        , "test_for_1.bas"        , nullptr },
+  { "test_if_goto"      , "test_if_goto.bas"      , nullptr },
+  { "test_list"         , "test_list.bas"         , nullptr },
+  { "test_plot"         , "test_plot.bas"         , nullptr, true },
+  { "test_read"         , "test_read.bas"         , nullptr },
+  { "test1"             , "test1.bsc"             , nullptr },
+  { "test2"             , "test2.bsc"             , nullptr },
+  { "test3"             , "test3.bsc"             , nullptr },
+  { "test4"             , "test4.bsc"             , nullptr },
+  { "test5"             , "test5.bsc"             , nullptr },
+  { "test6"             , "test6.bsc"             , nullptr },
+  { "test7"             , "test7.bsc"             , "check/test7.keys"  },
+  { "test8"             , "test8.bsc"             , nullptr },
+  { "test9"             , "test9.bsc"             , nullptr },
+  { "test10"            , "test10.bsc"            , nullptr },
+  { "test11"            , "test11.bsc"            , nullptr },
+  { "test12"            , "test12.bsc"            , nullptr },
+  { "test13"            , "test13.bsc"            , nullptr },
+  { "test_array"        , "test_array.bsc"        , nullptr },
+  { "test_for_bsc"      , "test_for.bsc"          , nullptr },
+  { "test_poke_peek"    , "test_poke_peek.bsc"    , nullptr },
+  { "test_print"        , "test_print.bsc"        , nullptr },
+  { "valley"            , "valley/valley.bas"     , "bench/valley.keys" },
+};
+
+// fixed RND seed so runs are repeatable
+const ulong s_randomSeed = 1;
+
+// statement limit (stops programs which loop forever)
+const long s_maxStatements = 5000000;
+
+const char *statusName(CPetBasic::RunStatus status)
+{
+  switch (status) {
+    case CPetBasic::RunStatus::RUNNING: return "limit";
+    case CPetBasic::RunStatus::WAITING: return "waiting";
+    case CPetBasic::RunStatus::STOPPED: return "stopped";
+    default:                            return "error";
+  }
+}
+
+// write framebuffer PPM and return its header (size)
+std::string ppmHeader(const CPetBasicNullTerm *term)
+{
+  char fileName[] = "/tmp/CPetBasicCheckXXXXXX";
+
+  int fd = mkstemp(fileName);
+  if (fd < 0) return "<no temp file>";
+
+  ::close(fd);
+
+  std::string header;
+
+  if (term->writeFrameBuffer(fileName)) {
+    std::ifstream fs(fileName, std::ios::binary);
+
+    std::string magic, w, h, depth;
+
+    fs >> magic >> w >> h >> depth;
+
+    // check pixel data is all there
+    fs.get();
+
+    auto start = fs.tellg();
+
+    fs.seekg(0, std::ios::end);
+
+    auto size = long(fs.tellg() - start);
+
+    header = magic + " " + w + "x" + h + " " + depth + " " + std::to_string(size) + " bytes";
+  }
+  else
+    header = "<write failed>";
+
+  ::unlink(fileName);
+
+  return header;
+}
+
+// run case and return output (screen, stderr and status)
+std::string runCase(const Case &checkCase, const std::string &dataDir)
+{
+  std::stringstream errs;
+
+  auto *buf = std::cerr.rdbuf(errs.rdbuf());
+
+  auto status = CPetBasic::RunStatus::ERROR;
+
+  CPetBasic basic;
+
+  basic.setHeadless();
+
+  basic.setRandomSeed(s_randomSeed);
+  basic.setVirtualClock(true);
+
+  if (basic.loadFile(dataDir + "/" + checkCase.fileName) &&
+      (! checkCase.keysFile || basic.loadInputScript(dataDir + "/" + checkCase.keysFile))) {
+    basic.startRun();
+
+    long statements = 0;
+
+    while (statements < s_maxStatements) {
+      status = basic.runFor(10000);
+
+      statements += 10000;
+
+      if (status == CPetBasic::RunStatus::STOPPED ||
+          status == CPetBasic::RunStatus::ERROR)
+        break;
+
+      // delays don't wait
+      if (status == CPetBasic::RunStatus::WAITING &&
+          basic.waitType() == CPetBasic::WaitType::DELAY) {
+        basic.skipDelay();
+        continue;
+      }
+
+      // waiting for input with no script keys left
+      if (status == CPetBasic::RunStatus::WAITING && ! basic.canResume())
+        break;
+    }
+  }
+
+  std::cerr.rdbuf(buf);
+
+  auto *term = static_cast<CPetBasicNullTerm *>(basic.term());
+
+  term->flush();
+
+  auto str = term->screenText() + "--- stderr\n" + errs.str() +
+             "--- status " + statusName(status) + "\n";
+
+  if (checkCase.ppm)
+    str += "--- ppm " + ppmHeader(term) + "\n";
+
+  return str;
+}
+
+bool readFile(const std::string &fileName, std::string &str)
+{
+  std::ifstream fs(fileName, std::ios::binary);
+  if (! fs) return false;
+
+  std::stringstream ss;
+
+  ss << fs.rdbuf();
+
+  str = ss.str();
+
+  return true;
+}
+
+bool writeFile(const std::string &fileName, const std::string &str)
+{
+  std::ofstream fs(fileName, std::ios::binary);
+  if (! fs) return false;
+
+  fs << str;
+
+  return bool(fs);
+}
+
+// report first differing line
+void printDiff(const std::string &expected, const std::string &actual)
+{
+  std::stringstream ss1(expected), ss2(actual);
+
+  std::string line1, line2;
+
+  for (int i = 1; ; ++i) {
+    bool rc1 = bool(std::getline(ss1, line1));
+    bool rc2 = bool(std::getline(ss2, line2));
+
+    if (! rc1 && ! rc2)
+      break;
+
+    if (! rc1) line1 = "<end>";
+    if (! rc2) line2 = "<end>";
+
+    if (line1 != line2) {
+      std::cerr << "  line " << i << "\n" <<
+                   "  expected: " << line1 << "\n" <<
+                   "  actual  : " << line2 << "\n";
+      break;
+    }
+  }
+}
+
+}
+
+//---
+
+int
+main(int argc, char **argv)
+{
+  std::string dataDir = "data";
+
+  bool update = false;
+
+  std::vector<std::string> names;
+
+  for (int i = 1; i < argc; ++i) {
+    if (argv[i][0] == '-') {
+      auto arg = std::string(&argv[i][1]);
+
+      if      (arg == "data" && i + 1 < argc) dataDir = argv[++i];
+      else if (arg == "update") update = true;
+      else if (arg == "list") {
+        for (const auto &checkCase : s_cases)
+          std::cout << checkCase.name << "\n";
+        return 0;
+      }
+      else {
+        std::cerr << "Usage: CPetBasicCheck [-data <dir>] [-update] [-list] [<case> ...]\n";
+        return 1;
+      }
+    }
+    else
+      names.push_back(argv[i]);
+  }
+
+  int numPassed = 0, numFailed = 0;
+
+  for (const auto &checkCase : s_cases) {
+    if (! names.empty() && std::find(names.begin(), names.end(), checkCase.name) == names.end())
+      continue;
+
+    auto actual = runCase(checkCase, dataDir);
+
+    auto outFile = dataDir + "/check/" + checkCase.name + ".out";
+
+    if (update) {
+      if (! writeFile(outFile, actual)) {
+        std::cerr << "Failed to write '" << outFile << "'\n";
+        return 1;
+      }
+
+      continue;
+    }
+
+    std::string expected;
+
+    if (! readFile(outFile, expected)) {
+      std::cerr << "FAIL " << checkCase.name << " : no stored output '" << outFile << "'\n";
+      ++numFailed;
+      continue;
+    }
+
+    if (actual != expected) {
+      std::cerr << "FAIL " << checkCase.name << "\n";
+
+      printDiff(expected, actual);
+
+      ++numFailed;
+    }
+    else
+      ++numPassed;
+  }
+
+  if (! update)
+    std::cout << numPassed << " passed, " << numFailed << " failed\n";
+
+  return (numFailed > 0 ? 1 : 0);
+}
@@ -1,4 +1,7 @@
 #include <CPetBasic.h>
+#include <CPetBasicNullTerm.h>
+
+#include <cstdlib>
 
 int
 main(int argc, char **argv)
@@ -13,6 +16,15 @@ main(int argc, char **argv)
   bool loop      = false;
   bool raw       = false;
   bool debug     = false;
+  bool profile   = false;
+  bool sample    = false;
+  bool metrics   = false;
+  bool headless  = false;
+
+  std::string screenFile, ppmFile, keysFile, traceFile, replayFile;
+
+  long seed       = -1;
+  long clockUSecs = -1;
 
   for (int i = 1; i < argc; ++i) {
     if (argv[i][0] == '-') {
@@ -24,6 +36,17 @@ main(int argc, char **argv)
       else if (arg == "loop"     ) loop      = true;
       else if (arg == "raw"      ) raw       = true;
       else if (arg == "debug"    ) debug     = true;
+      else if (arg == "profile"  ) profile   = true;
+      else if (arg == "sample"   ) sample    = true;
+      else if (arg == "metrics"  ) metrics   = true;
+      else if (arg == "headless" ) headless  = true;
+      else if (arg == "screen" && i + 1 < argc) screenFile = argv[++i];
+      else if (arg == "ppm"    && i + 1 < argc) ppmFile    = argv[++i];
+      else if (arg == "keys"   && i + 1 < argc) keysFile   = argv[++i];
+      else if (arg == "seed"   && i + 1 < argc) seed       = std::atol(argv[++i]);
+      else if (arg == "clock"  && i + 1 < argc) clockUSecs = std::atol(argv[++i]);
+      else if (arg == "trace"  && i + 1 < argc) traceFile  = argv[++i];
+      else if (arg == "replay" && i + 1 < argc) replayFile = argv[++i];
     }
     else
       fileNames.push_back(argv[i]);
@@ -33,10 +56,33 @@ main(int argc, char **argv)
 
   basic.setListHighlight(highlight);
 
-  if (raw)
+  if      (headless)
+    basic.setHeadless();
+  else if (raw)
     basic.setRaw(true);
 
   basic.setDebug(debug);
+  basic.setProfile(profile);
+
+  if (seed >= 0)
+    basic.setRandomSeed(ulong(seed));
+
+  // virtual clock with usecs per statement
+  if (clockUSecs >= 0)
+    basic.setVirtualClock(true, clockUSecs);
+
+  if (keysFile != "" && ! basic.loadInputScript(keysFile))
+    return 1;
+
+  if (traceFile != "" && ! basic.startTraceRecord(traceFile)) {
+    std::cerr << "Failed to record trace '" << traceFile << "'\n";
+    return 1;
+  }
+
+  if (replayFile != "" && ! basic.startTraceReplay(replayFile)) {
+    std::cerr << "Failed to replay trace '" << replayFile << "'\n";
+    return 1;
+  }
 
   for (const auto &fileName : fileNames)
     basic.loadFile(fileName);
@@ -44,11 +90,41 @@ main(int argc, char **argv)
   if (list)
     basic.list();
 
+  if (sample)
+    basic.startSampling();
+
   if (run)
     basic.run();
 
+  if (sample) {
+    basic.stopSampling();
+
+    basic.printSamples(std::cerr);
+  }
+
+  if (profile)
+    basic.printProfile(std::cerr);
+
   if (loop)
     basic.loop();
 
+  if (headless) {
+    auto *term = static_cast<CPetBasicNullTerm *>(basic.term());
+
+    term->flush();
+
+    if (screenFile != "" && ! term->writeScreen(screenFile))
+      std::cerr << "Failed to write '" << screenFile << "'\n";
+
+    if (ppmFile != "" && ! term->writeFrameBuffer(ppmFile))
+      std::cerr << "Failed to write '" << ppmFile << "'\n";
+  }
+
+  if (metrics) {
+    basic.updateMetrics();
+
+    std::cerr << basic.metrics().toJson() << "\n";
+  }
+
   return 0;
 }